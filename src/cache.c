@@ -0,0 +1,421 @@
+#include "cache.h"
+#include "utils.h"
+
+#include <string.h>
+
+#include <errno.h>
+#include <glob.h>
+#include <ifaddrs.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif // __APPLE__
+
+// this should be plenty, there's a handful of cacheable modules
+#define CACHE_ENTRIES 64
+
+// starting value of the FNV-1a hashes of fingerprints
+#define FNV_OFFSET 14695981039346656037ull
+
+struct Entry {
+    char id[32];
+    char fingerprint[320];
+    long long made;
+    char value[256];
+};
+
+static struct Entry entries[CACHE_ENTRIES];
+static size_t entry_count = 0;
+static bool dirty = false;
+
+int cache_dir(char *dest, const size_t len) {
+    char *cache_home = getenv("XDG_CACHE_HOME");
+    char *home = getenv("HOME");
+
+    if(cache_home && cache_home[0]) {
+        mkdir(cache_home, 0755);
+
+        snprintf(dest, len, "%s/albafetch", cache_home);
+    }
+    else if(home && home[0]) {
+        snprintf(dest, len, "%s/.cache", home);
+        mkdir(dest, 0755);
+
+        snprintf(dest, len, "%s/.cache/albafetch", home);
+    }
+    else
+        return 1;
+
+    if(mkdir(dest, 0755) && errno != EEXIST)
+        return 1;
+
+    return 0;
+}
+
+int cache_load(void) {
+    char path[320];
+
+    entry_count = 0;
+    dirty = false;
+
+    if(cache_dir(path, sizeof(path)))
+        return 1;
+    strncat(path, "/cache", sizeof(path)-strlen(path)-1);
+
+    FILE *fp = fopen(path, "r");
+    if(fp == NULL)
+        return 1;
+
+    // every line looks like "id\tfingerprint\tmade\tvalue"
+    char line[sizeof(struct Entry) + 24];
+    while(entry_count < CACHE_ENTRIES && fgets(line, sizeof(line), fp)) {
+        char *fingerprint, *made, *value, *end;
+
+        if((fingerprint = strchr(line, '\t')) == NULL)
+            continue;
+        *fingerprint++ = 0;
+
+        if((made = strchr(fingerprint, '\t')) == NULL)
+            continue;
+        *made++ = 0;
+
+        const long long stamp = strtoll(made, &value, 10);
+        if(value == made || *value != '\t')
+            continue;
+        *value++ = 0;
+
+        if((end = strchr(value, '\n')))
+            *end = 0;
+
+        struct Entry *entry = entries + entry_count++;
+        strncpy(entry->id, line, sizeof(entry->id)-1);
+        entry->id[sizeof(entry->id)-1] = 0;
+        strncpy(entry->fingerprint, fingerprint, sizeof(entry->fingerprint)-1);
+        entry->fingerprint[sizeof(entry->fingerprint)-1] = 0;
+        entry->made = stamp;
+        strncpy(entry->value, value, sizeof(entry->value)-1);
+        entry->value[sizeof(entry->value)-1] = 0;
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
+static struct Entry *find_entry(const char *id) {
+    for(size_t i = 0; i < entry_count; ++i)
+        if(strcmp(entries[i].id, id) == 0)
+            return entries + i;
+
+    return NULL;
+}
+
+int cache_get(const char *id, const char *fingerprint, char *dest, time_t *made) {
+    struct Entry *entry = find_entry(id);
+
+    if(entry == NULL || strcmp(entry->fingerprint, fingerprint))
+        return 1;
+
+    strcpy(dest, entry->value);
+    *made = (time_t)entry->made;
+
+    return 0;
+}
+
+void cache_set(const char *id, const char *fingerprint, const char *value, const time_t made) {
+    // these would break the file format
+    if(strlen(id) >= sizeof(entries[0].id) || strpbrk(id, "\t\n")
+       || strlen(fingerprint) >= sizeof(entries[0].fingerprint) || strpbrk(fingerprint, "\t\n")
+       || strlen(value) >= sizeof(entries[0].value) || strchr(value, '\n'))
+        return;
+
+    struct Entry *entry = find_entry(id);
+
+    if(entry == NULL) {
+        if(entry_count >= CACHE_ENTRIES)
+            return;
+
+        entry = entries + entry_count++;
+        strcpy(entry->id, id);
+    }
+    else if(strcmp(entry->fingerprint, fingerprint) == 0 && strcmp(entry->value, value) == 0
+            && entry->made == (long long)made)
+        return;
+
+    strcpy(entry->fingerprint, fingerprint);
+    strcpy(entry->value, value);
+    entry->made = (long long)made;
+
+    dirty = true;
+}
+
+void cache_save(void) {
+    char path[320], tmp[352];
+
+    if(dirty == false || cache_dir(path, sizeof(path)))
+        return;
+    strncat(path, "/cache", sizeof(path)-strlen(path)-1);
+
+    // written to a temporary file first, so that other instances never read half of it
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+
+    FILE *fp = fopen(tmp, "w");
+    if(fp == NULL)
+        return;
+
+    for(size_t i = 0; i < entry_count; ++i)
+        fprintf(fp, "%s\t%s\t%lld\t%s\n", entries[i].id, entries[i].fingerprint, entries[i].made, entries[i].value);
+
+    if(fclose(fp) || rename(tmp, path))
+        unlink(tmp);
+    else
+        dirty = false;
+}
+
+// append a short description of the file at path to dest ("-" if it's missing)
+static void stat_path(char *dest, const size_t len, const char *path) {
+    struct stat st;
+    size_t used = strlen(dest);
+
+    if(stat(path, &st))
+        snprintf(dest+used, len-used, "-;");
+    else
+        snprintf(dest+used, len-used, "%lx.%lx.%lx;",
+                 (unsigned long)st.st_ino, (unsigned long)st.st_mtime, (unsigned long)st.st_size);
+}
+
+// FNV-1a, continuing from hash
+static uint64_t hash_bytes(uint64_t hash, const void *data, const size_t len) {
+    const unsigned char *bytes = data;
+
+    for(size_t i = 0; i < len; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+// hash a short description of the file at path (or the fact that it's missing) into hash
+static uint64_t hash_path(uint64_t hash, const char *path) {
+    struct stat st;
+
+    if(stat(path, &st))
+        return hash_bytes(hash, "-", 1);
+
+    const uint64_t values[] = {(uint64_t)st.st_ino, (uint64_t)st.st_mtime, (uint64_t)st.st_size};
+
+    return hash_bytes(hash, values, sizeof(values));
+}
+
+int fingerprint_boot(char *dest) {
+    static char boot_id[64] = "";
+
+    if(boot_id[0] == 0) {
+        #ifdef __APPLE__
+            struct timeval boottime;
+            size_t len = sizeof(boottime);
+
+            if(sysctlbyname("kern.boottime", &boottime, &len, NULL, 0))
+                return 1;
+
+            snprintf(boot_id, sizeof(boot_id), "%ld", (long)boottime.tv_sec);
+        #else
+            FILE *fp = fopen("/proc/sys/kernel/random/boot_id", "r");
+            if(fp == NULL)
+                return 1;
+
+            size_t len = fread(boot_id, 1, sizeof(boot_id)-1, fp);
+            fclose(fp);
+
+            boot_id[len] = 0;
+            if(len && boot_id[len-1] == '\n')
+                boot_id[len-1] = 0;
+        #endif
+    }
+
+    if(boot_id[0] == 0)
+        return 1;
+
+    strcpy(dest, boot_id);
+
+    return 0;
+}
+
+int fingerprint_os(char *dest) {
+    #ifdef __linux__
+        dest[0] = 0;
+        stat_path(dest, 256, access("/etc/os-release", F_OK) == 0 ? "/etc/os-release" : "/usr/lib/os-release");
+
+        return 0;
+    #else
+        // the version only changes with an update, which needs a reboot
+        return fingerprint_boot(dest);
+    #endif
+}
+
+// hash every python package directory pip could list into hash
+static uint64_t hash_python_dirs(uint64_t hash, const char *prefix) {
+    const char *patterns[] = {
+        "%s/usr/lib/python3*/*-packages",
+        "%s/usr/lib64/python3*/site-packages",
+        "%s/usr/local/lib/python3*/*-packages",
+        "%s/lib/python3*/site-packages",
+        "%s/.local/lib/python3*/site-packages",
+    };
+    const size_t pattern_num = sizeof(patterns)/sizeof(patterns[0]);
+
+    char *home = getenv("HOME");
+    char pattern[320];
+
+    for(size_t i = 0; i < pattern_num; ++i) {
+        if(i == pattern_num-1 && home == NULL)
+            break;
+
+        snprintf(pattern, sizeof(pattern), patterns[i], i == pattern_num-1 ? home : prefix);
+
+        glob_t found;
+        if(glob(pattern, 0, NULL, &found))
+            continue;
+
+        for(size_t j = 0; j < found.gl_pathc; ++j)
+            hash = hash_path(hash, found.gl_pathv[j]);
+
+        globfree(&found);
+    }
+
+    return hash;
+}
+
+int fingerprint_packages(char *dest) {
+    struct Source {
+        const char *path;
+        bool enabled;
+    };
+    const struct Source sources[] = {
+        {"/var/lib/pacman/local", pkg_pacman},
+        {"/var/lib/dpkg/status", pkg_dpkg},
+        {"/var/lib/rpm/rpmdb.sqlite", pkg_rpm},
+        {"/var/lib/rpm/rpmdb.sqlite-wal", pkg_rpm},
+        {"/var/lib/flatpak/app", pkg_flatpak},
+        {"/var/lib/flatpak/runtime", pkg_flatpak},
+        {"/var/lib/snapd/snaps", pkg_snap},
+        {"/snap", pkg_snap},
+        {"/bin/pip", pkg_pip},
+        {"/lib/apk/db/installed", pkg_apk},
+        {"/var/db/xbps", pkg_xbps},
+        {"/var/db/pkg", pkg_portage},
+        {"/nix/var/nix/profiles/default", pkg_nix},
+    };
+    // these don't depend on $PREFIX
+    const struct Source cellars[] = {
+        {"/opt/homebrew/Cellar", pkg_brew},
+        {"/usr/local/Cellar", pkg_brew},
+        {"/home/linuxbrew/.linuxbrew/Cellar", pkg_brew},
+    };
+
+    char prefix[128] = "", path[256];
+    if(getenv("PREFIX"))
+        strncpy(prefix, getenv("PREFIX"), sizeof(prefix)-1);
+
+    // there can be quite a few of them, so they are hashed instead of being listed
+    uint64_t hash = FNV_OFFSET;
+
+    for(size_t i = 0; i < sizeof(sources)/sizeof(sources[0]); ++i) {
+        if(sources[i].enabled == false)
+            continue;
+
+        snprintf(path, sizeof(path), "%s%s", prefix, sources[i].path);
+        hash = hash_path(hash, path);
+    }
+    for(size_t i = 0; i < sizeof(cellars)/sizeof(cellars[0]); ++i)
+        if(cellars[i].enabled)
+            hash = hash_path(hash, cellars[i].path);
+    if(pkg_flatpak && getenv("HOME")) {
+        snprintf(path, sizeof(path), "%s/.local/share/flatpak/app", getenv("HOME"));
+        hash = hash_path(hash, path);
+        snprintf(path, sizeof(path), "%s/.local/share/flatpak/runtime", getenv("HOME"));
+        hash = hash_path(hash, path);
+    }
+    if(pkg_nix && getenv("HOME")) {
+        snprintf(path, sizeof(path), "%s/.nix-profile", getenv("HOME"));
+        hash = hash_path(hash, path);
+    }
+    if(pkg_pip)
+        hash = hash_python_dirs(hash, prefix);
+
+    snprintf(dest, 256, "%016llx", (unsigned long long)hash);
+
+    return 0;
+}
+
+int fingerprint_cpu(char *dest) {
+    // the current clock speed changes all the time, the highest one does not
+    if((cpu_freq) && (cpu_max_freq) == 0)
+        return 1;
+
+    return fingerprint_boot(dest);
+}
+
+int fingerprint_network(char *dest) {
+    uint64_t hash = FNV_OFFSET;
+
+    #ifdef __linux__
+        // the interface and gateway of every default route (the destination is 00000000)
+        FILE *fp = fopen("/proc/net/route", "r");
+        if(fp) {
+            char line[256];
+
+            while(fgets(line, sizeof(line), fp)) {
+                char iface[32];
+                unsigned long destination, gateway;
+
+                if(sscanf(line, "%31s %lx %lx", iface, &destination, &gateway) == 3 && destination == 0) {
+                    hash = hash_bytes(hash, iface, strlen(iface));
+                    hash = hash_bytes(hash, &gateway, sizeof(gateway));
+                }
+            }
+
+            fclose(fp);
+        }
+    #endif // __linux__
+
+    // the addresses of every interface (a new network usually means a new address)
+    struct ifaddrs *addrs;
+    if(getifaddrs(&addrs))
+        return 1;
+
+    for(struct ifaddrs *addr = addrs; addr; addr = addr->ifa_next) {
+        if(addr->ifa_addr == NULL || addr->ifa_name == NULL)
+            continue;
+
+        hash = hash_bytes(hash, addr->ifa_name, strlen(addr->ifa_name));
+
+        if(addr->ifa_addr->sa_family == AF_INET) {
+            const struct in_addr *ip = &((const struct sockaddr_in *)addr->ifa_addr)->sin_addr;
+            hash = hash_bytes(hash, ip, sizeof(*ip));
+        }
+        else if(addr->ifa_addr->sa_family == AF_INET6) {
+            const struct in6_addr *ip = &((const struct sockaddr_in6 *)addr->ifa_addr)->sin6_addr;
+            hash = hash_bytes(hash, ip, sizeof(*ip));
+        }
+    }
+
+    freeifaddrs(addrs);
+
+    // the endpoints that were asked
+    for(size_t i = 0; i < PUB_ENDPOINTS; ++i)
+        hash = hash_bytes(hash, config.pub_endpoints[i], strlen(config.pub_endpoints[i]) + 1);
+
+    snprintf(dest, 256, "%016llx", (unsigned long long)hash);
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <time.h>
+
+/*
+ * Outputs of slow modules are kept in $XDG_CACHE_HOME/albafetch/cache
+ * (~/.cache/albafetch/cache if it's not set), together with a fingerprint
+ * of whatever the output depends on. An entry is only used as long as the
+ * fingerprint stays the same.
+ *
+ * None of these functions are thread safe, they are meant to be used
+ * before and after the modules run.
+ */
+
+// get (and create) the albafetch cache directory, 0 on success
+int cache_dir(char *dest, const size_t len);
+
+// read the cache file, 0 on success
+int cache_load(void);
+
+// copy the cached output of id to dest (and when it was made to made) if its fingerprint matches, 0 on hit
+int cache_get(const char *id, const char *fingerprint, char *dest, time_t *made);
+
+// remember the output of id for a given fingerprint, made at the given time
+void cache_set(const char *id, const char *fingerprint, const char *value, const time_t made);
+
+// write the cache file back, if anything changed
+void cache_save(void);
+
+/*
+ * Fingerprints, used to tell whether a cached output is still valid.
+ * They write up to 256 bytes to dest and return 0 on success,
+ * or 1 if the module should not be cached.
+ */
+
+// changes on every boot (hardware infos)
+int fingerprint_boot(char *dest);
+
+// changes when /etc/os-release does
+int fingerprint_os(char *dest);
+
+// changes when any enabled package database does
+int fingerprint_packages(char *dest);
+
+// like fingerprint_boot, unless the current clock is printed
+int fingerprint_cpu(char *dest);
+
+// changes with the default routes and the addresses of the interfaces (pub_ttl is up to the caller)
+int fingerprint_network(char *dest);
+
+#endif // CACHE_H
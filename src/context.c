@@ -0,0 +1,385 @@
+#include "context.h"
+#include "keyval.h"
+#include "themes.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+extern char **environ;
+
+void context_init(struct Context *ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+
+    for(int i = 0; i < FACT_NUM; ++i)
+        pthread_mutex_init(ctx->locks + i, NULL);
+}
+
+void context_set_client(struct Context *ctx, char **env, const char *cwd, const pid_t parent) {
+    ctx->client_env = env;
+    ctx->client_cwd = cwd;
+    ctx->client_parent = parent;
+}
+
+void context_destroy(struct Context *ctx) {
+    for(int i = 0; i < FACT_NUM; ++i)
+        pthread_mutex_destroy(ctx->locks + i);
+
+    free(ctx->env);
+    ctx->env = NULL;
+    ctx->env_count = 0;
+}
+
+static int load_uname(struct Context *ctx) {
+    return uname(&ctx->uname) != 0;
+}
+
+static int load_sysinfo(struct Context *ctx) {
+    #ifndef __APPLE__
+        return sysinfo(&ctx->sysinfo) != 0;
+    #else
+        (void)ctx;
+        return 1;
+    #endif // __APPLE__
+}
+
+// how long (in ms) NSS gets to answer, it may have to ask a directory server (LDAP, SSSD...)
+#define NSS_TIMEOUT 500
+
+// copy as much of src as fits in dest (nothing if it's NULL)
+static void copy_field(char *dest, const size_t len, const char *src) {
+    const size_t copied = src ? strnlen(src, len-1) : 0;
+
+    if(copied)
+        memcpy(dest, src, copied);
+    dest[copied] = 0;
+}
+
+// copy the fields of a passwd entry that are used to user
+static void copy_user(struct User *user, const char *name, const char *home, const char *shell) {
+    copy_field(user->name, sizeof(user->name), name);
+    copy_field(user->home, sizeof(user->home), home);
+    copy_field(user->shell, sizeof(user->shell), shell);
+}
+
+// look uid up in /etc/passwd, without going through NSS
+static int passwd_user(struct User *user, const uid_t uid) {
+    FILE *fp = fopen("/etc/passwd", "r");
+    if(fp == NULL)
+        return 1;
+
+    // every line looks like "name:password:uid:gid:gecos:home:shell"
+    char line[1024];
+    int ret = 1;
+    bool cut = false;
+
+    while(ret && fgets(line, sizeof(line), fp)) {
+        // the rest of a line that didn't fit is skipped
+        const bool was_cut = cut;
+        char *newline = strchr(line, '\n');
+        cut = newline == NULL && feof(fp) == 0;
+        if(newline)
+            *newline = 0;
+        if(was_cut || cut)
+            continue;
+
+        char *fields[7];
+        char *ptr = line;
+        size_t count = 0;
+
+        while(count < 7) {
+            fields[count++] = ptr;
+
+            if((ptr = strchr(ptr, ':')) == NULL)
+                break;
+            *ptr++ = 0;
+        }
+
+        if(count < 7)
+            continue;
+
+        char *end;
+        const unsigned long entry_uid = strtoul(fields[2], &end, 10);
+        if(end == fields[2] || *end || entry_uid != uid)
+            continue;
+
+        copy_user(user, fields[0], fields[5], fields[6]);
+        ret = 0;
+    }
+
+    fclose(fp);
+
+    return ret;
+}
+
+/* trust $USER (or $LOGNAME) if $HOME belongs to uid
+ * this rules out the variables left behind by su and sudo
+ */
+static int env_user(struct Context *ctx, struct User *user, const uid_t uid) {
+    const char *name = ctx_getenv(ctx, "USER");
+    const char *home = ctx_getenv(ctx, "HOME");
+    struct stat st;
+
+    if(name == NULL || name[0] == 0)
+        name = ctx_getenv(ctx, "LOGNAME");
+
+    if(name == NULL || name[0] == 0 || strchr(name, ':') || home == NULL || home[0] == 0
+       || stat(home, &st) || st.st_uid != uid)
+        return 1;
+
+    copy_user(user, name, home, ctx_getenv(ctx, "SHELL"));
+
+    return 0;
+}
+
+// a getpwuid_r() call that may outlive the wait for it
+struct Lookup {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned refs;          // load_user() and the thread, if it's still running
+    bool finished;
+    int ret;
+
+    uid_t uid;
+    struct User user;
+};
+
+// let go of lookup
+static void release_lookup(struct Lookup *lookup) {
+    pthread_mutex_lock(&lookup->lock);
+    const bool last = --lookup->refs == 0;
+    pthread_mutex_unlock(&lookup->lock);
+
+    if(last) {
+        pthread_cond_destroy(&lookup->cond);
+        pthread_mutex_destroy(&lookup->lock);
+        free(lookup);
+    }
+}
+
+static void *lookup_thread(void *arg) {
+    struct Lookup *lookup = arg;
+    struct passwd entry, *pw = NULL;
+    char buf[16384];
+
+    const int ret = getpwuid_r(lookup->uid, &entry, buf, sizeof(buf), &pw) || pw == NULL;
+
+    pthread_mutex_lock(&lookup->lock);
+    if(ret == 0)
+        copy_user(&lookup->user, pw->pw_name, pw->pw_dir, pw->pw_shell);
+    lookup->ret = ret;
+    lookup->finished = true;
+    pthread_cond_signal(&lookup->cond);
+    pthread_mutex_unlock(&lookup->lock);
+
+    release_lookup(lookup);
+
+    return NULL;
+}
+
+// ask NSS for uid, giving up after NSS_TIMEOUT
+static int nss_user(struct User *user, const uid_t uid) {
+    struct Lookup *lookup = calloc(1, sizeof(*lookup));
+    if(lookup == NULL)
+        return 1;
+
+    pthread_mutex_init(&lookup->lock, NULL);
+    pthread_cond_init(&lookup->cond, NULL);
+    lookup->refs = 2;
+    lookup->uid = uid;
+
+    pthread_t thread;
+    if(pthread_create(&thread, NULL, lookup_thread, lookup)) {
+        lookup->refs = 1;
+        release_lookup(lookup);
+        return 1;
+    }
+    pthread_detach(thread);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += NSS_TIMEOUT * 1000000L;
+    if(deadline.tv_nsec >= 1000000000L) {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&lookup->lock);
+    while(lookup->finished == false && pthread_cond_timedwait(&lookup->cond, &lookup->lock, &deadline) != ETIMEDOUT);
+
+    const int ret = lookup->finished ? lookup->ret : 1;
+    if(ret == 0)
+        *user = lookup->user;
+    pthread_mutex_unlock(&lookup->lock);
+
+    release_lookup(lookup);
+
+    return ret;
+}
+
+static int load_user(struct Context *ctx) {
+    const uid_t uid = geteuid();
+
+    // from the cheapest to the one that may need the network
+    if(passwd_user(&ctx->user, uid) == 0 || env_user(ctx, &ctx->user, uid) == 0)
+        return 0;
+
+    return nss_user(&ctx->user, uid);
+}
+
+static int load_os_release(struct Context *ctx) {
+    char buf[4096];
+    long len = keyval_read("/etc/os-release", buf, sizeof(buf));
+
+    if(len < 0 && (len = keyval_read("/usr/lib/os-release", buf, sizeof(buf))) < 0)
+        return 1;
+
+    struct KeyVal keys[] = {
+        {"ID=", NULL, 0},
+        {"PRETTY_NAME=", NULL, 0},
+    };
+    if(keyval_find(buf, (size_t)len, keys, sizeof(keys)/sizeof(keys[0])) == 0)
+        return 1;
+
+    keyval_copy(ctx->os_release.id, sizeof(ctx->os_release.id), keys);
+    keyval_copy(ctx->os_release.pretty_name, sizeof(ctx->os_release.pretty_name), keys+1);
+
+    return 0;
+}
+
+// compare two "NAME=value" (or just "NAME") strings by NAME
+static int compare_names(const char *a, const char *b) {
+    while(*a && *a != '=' && *a == *b) {
+        ++a;
+        ++b;
+    }
+
+    const unsigned char char_a = *a == '=' ? 0 : (unsigned char)*a;
+    const unsigned char char_b = *b == '=' ? 0 : (unsigned char)*b;
+
+    return (int)char_a - (int)char_b;
+}
+
+static int compare_env(const void *a, const void *b) {
+    return compare_names(*(char *const *)a, *(char *const *)b);
+}
+
+static int load_env(struct Context *ctx) {
+    char **const vars = ctx->client_env ? ctx->client_env : environ;
+
+    size_t count = 0;
+    while(vars && vars[count])
+        ++count;
+
+    if(count == 0)
+        return 1;
+
+    ctx->env = malloc(count * sizeof(char *));
+    if(ctx->env == NULL)
+        return 1;
+
+    memcpy(ctx->env, vars, count * sizeof(char *));
+    qsort(ctx->env, count, sizeof(char *), compare_env);
+    ctx->env_count = count;
+
+    return 0;
+}
+
+static int load_themes(struct Context *ctx) {
+    themes_read(&ctx->themes, ctx);
+
+    return 0;
+}
+
+static int load_themes_gsettings(struct Context *ctx) {
+    themes_gsettings(&ctx->themes_gsettings);
+
+    return 0;
+}
+
+// fetch fact the first time it's needed, returns 0 if it is available
+static int load(struct Context *ctx, const enum Fact fact) {
+    static int (*const loaders[FACT_NUM])(struct Context *) = {
+        load_uname,
+        load_sysinfo,
+        load_user,
+        load_os_release,
+        load_env,
+        load_themes,
+        load_themes_gsettings,
+    };
+
+    pthread_mutex_lock(ctx->locks + fact);
+
+    if(ctx->loaded[fact] == false) {
+        ctx->failed[fact] = loaders[fact](ctx) != 0;
+        ctx->loaded[fact] = true;
+    }
+
+    const int ret = ctx->failed[fact];
+    pthread_mutex_unlock(ctx->locks + fact);
+
+    return ret;
+}
+
+const struct utsname *ctx_uname(struct Context *ctx) {
+    return load(ctx, FACT_UNAME) ? NULL : &ctx->uname;
+}
+
+#ifndef __APPLE__
+const struct sysinfo *ctx_sysinfo(struct Context *ctx) {
+    return load(ctx, FACT_SYSINFO) ? NULL : &ctx->sysinfo;
+}
+#endif // __APPLE__
+
+const struct User *ctx_user(struct Context *ctx) {
+    return load(ctx, FACT_USER) ? NULL : &ctx->user;
+}
+
+const struct OsRelease *ctx_os_release(struct Context *ctx) {
+    return load(ctx, FACT_OS_RELEASE) ? NULL : &ctx->os_release;
+}
+
+const char *ctx_getenv(struct Context *ctx, const char *name) {
+    if(load(ctx, FACT_ENV))
+        return NULL;
+
+    const char *key = name;
+    char **entry = bsearch(&key, ctx->env, ctx->env_count, sizeof(char *), compare_env);
+    if(entry == NULL)
+        return NULL;
+
+    const char *value = strchr(*entry, '=');
+
+    return value ? value+1 : NULL;
+}
+
+int ctx_getcwd(struct Context *ctx, char *dest, const size_t len) {
+    if(ctx->client_env == NULL)
+        return getcwd(dest, len) == NULL;
+
+    if(ctx->client_cwd == NULL || strlen(ctx->client_cwd) >= len)
+        return 1;
+
+    strcpy(dest, ctx->client_cwd);
+
+    return 0;
+}
+
+pid_t ctx_parent(struct Context *ctx) {
+    return ctx->client_env ? ctx->client_parent : getppid();
+}
+
+const struct Themes *ctx_themes(struct Context *ctx) {
+    return load(ctx, FACT_THEMES) ? NULL : &ctx->themes;
+}
+
+const struct Themes *ctx_themes_gsettings(struct Context *ctx) {
+    return load(ctx, FACT_THEMES_GSETTINGS) ? NULL : &ctx->themes_gsettings;
+}
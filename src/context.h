@@ -0,0 +1,118 @@
+#pragma once
+
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/utsname.h>
+
+#ifndef __APPLE__
+#include <sys/sysinfo.h>
+#endif // __APPLE__
+
+/*
+ * Facts shared by several modules, fetched the first time one of them
+ * asks for it and kept for the rest of the run.
+ * Every accessor is thread safe, and returns NULL if the fact is not available.
+ * What they return belongs to the context, and must not be modified.
+ */
+
+enum Fact {
+    FACT_UNAME,
+    FACT_SYSINFO,
+    FACT_USER,
+    FACT_OS_RELEASE,
+    FACT_ENV,
+    FACT_THEMES,
+    FACT_THEMES_GSETTINGS,
+    FACT_NUM
+};
+
+// the parts of the passwd entry of the current user that are used
+struct User {
+    char name[256];
+    char home[256];
+    char shell[256];
+};
+
+// the os-release fields that are used
+struct OsRelease {
+    char id[48];
+    char pretty_name[128];
+};
+
+// the desktop themes, empty if they are not set
+struct Themes {
+    char gtk[128];
+    char icon[128];
+    char cursor[128];
+};
+
+struct Context {
+    pthread_mutex_t locks[FACT_NUM];
+    bool loaded[FACT_NUM];  // whether a fact was fetched (even if it failed)
+    bool failed[FACT_NUM];
+
+    struct utsname uname;
+    #ifndef __APPLE__
+    struct sysinfo sysinfo;
+    #endif // __APPLE__
+    struct User user;
+    struct OsRelease os_release;
+
+    // the environment, sorted by variable name
+    char **env;
+    size_t env_count;
+
+    struct Themes themes;
+    struct Themes themes_gsettings;
+
+    // the process the output is for, if it's not albafetch itself (a client of the daemon)
+    char **client_env;      // NULL terminated
+    const char *client_cwd;
+    pid_t client_parent;
+};
+
+// set up an empty context, call this once per run
+void context_init(struct Context *ctx);
+
+// free everything fetched by ctx
+void context_destroy(struct Context *ctx);
+
+/* fetch the environment, working directory and parent of another process instead
+ * (the client of the daemon), call this before anything is fetched
+ * what is passed must outlive ctx, cwd may be NULL
+ */
+void context_set_client(struct Context *ctx, char **env, const char *cwd, const pid_t parent);
+
+const struct utsname *ctx_uname(struct Context *ctx);
+
+#ifndef __APPLE__
+const struct sysinfo *ctx_sysinfo(struct Context *ctx);
+#endif // __APPLE__
+
+const struct User *ctx_user(struct Context *ctx);
+
+const struct OsRelease *ctx_os_release(struct Context *ctx);
+
+// like getenv(), looked up in a snapshot of the environment taken on the first call
+const char *ctx_getenv(struct Context *ctx, const char *name);
+
+// like getcwd(), 0 on success
+int ctx_getcwd(struct Context *ctx, char *dest, const size_t len);
+
+// like getppid(), usually the shell
+pid_t ctx_parent(struct Context *ctx);
+
+// read from dconf, the toolkit settings files and the GSettings schemas, see themes.h
+const struct Themes *ctx_themes(struct Context *ctx);
+
+// asked to gsettings, only meant for the themes ctx_themes() could not find
+const struct Themes *ctx_themes_gsettings(struct Context *ctx);
+
+#endif // CONTEXT_H
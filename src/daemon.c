@@ -0,0 +1,291 @@
+#include "daemon.h"
+
+#include <string.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+// where the daemon listens, 0 on success
+static int socket_path(char *dest, const size_t len) {
+    char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    int written;
+
+    if(runtime_dir && runtime_dir[0])
+        written = snprintf(dest, len, "%s/albafetch.sock", runtime_dir);
+    else
+        written = snprintf(dest, len, "/tmp/albafetch-%u.sock", (unsigned)getuid());
+
+    return written < 0 || (size_t)written >= len;
+}
+
+// where the daemon is listening, removed when it gets stopped
+static char listening_path[sizeof(((struct sockaddr_un *)0)->sun_path)] = "";
+
+static void stop_daemon(int signal) {
+    (void)signal;
+
+    unlink(listening_path);
+    _exit(0);
+}
+
+// 0 once all of buf was written
+static int write_all(const int fd, const char *buf, size_t len) {
+    ssize_t written;
+
+    while(len) {
+        if((written = write(fd, buf, len)) < 0) {
+            if(errno == EINTR)
+                continue;
+            return 1;
+        }
+
+        buf += written;
+        len -= (size_t)written;
+    }
+
+    return 0;
+}
+
+// 0 once len bytes were read into buf
+static int read_all(const int fd, void *buf, size_t len) {
+    char *ptr = buf;
+    ssize_t got;
+
+    while(len) {
+        if((got = read(fd, ptr, len)) <= 0) {
+            if(got < 0 && errno == EINTR)
+                continue;
+            return 1;
+        }
+
+        ptr += got;
+        len -= (size_t)got;
+    }
+
+    return 0;
+}
+
+extern char **environ;
+
+/* read the request of a client, and what follows it, into client
+ * the working directory and the environment are kept in buf, which client points into
+ */
+static int read_client(const int fd, struct Client *client, char **buf) {
+    struct Request *request = &client->request;
+
+    if(read_all(fd, request, sizeof(*request))
+       || request->cwd_len >= PATH_MAX || request->env_len > DAEMON_MAX_ENV)
+        return 1;
+
+    request->logo[sizeof(request->logo)-1] = 0;
+    request->color[sizeof(request->color)-1] = 0;
+
+    // "cwd\0" and then the environment, with a NUL after its last variable
+    *buf = malloc((size_t)request->cwd_len + request->env_len + 2);
+    if(*buf == NULL)
+        return 1;
+
+    char *env = *buf + request->cwd_len + 1;
+    if(read_all(fd, *buf, request->cwd_len) || read_all(fd, env, request->env_len))
+        return 1;
+    (*buf)[request->cwd_len] = 0;
+    env[request->env_len] = 0;
+
+    client->cwd = request->cwd_len ? *buf : NULL;
+
+    // there's a variable before every NUL (at most)
+    size_t count = 0;
+    for(size_t i = 0; i < request->env_len; ++i)
+        count += env[i] == 0;
+
+    client->env = malloc((count + 1) * sizeof(char *));
+    if(client->env == NULL)
+        return 1;
+
+    const char *end = env + request->env_len;
+    count = 0;
+    while(env < end) {
+        const size_t len = strlen(env);
+
+        if(strchr(env, '='))
+            client->env[count++] = env;
+        env += len + 1;
+    }
+    client->env[count] = NULL;
+
+    return 0;
+}
+
+// don't let a stuck client block everyone else
+static void set_timeouts(const int fd, const long seconds) {
+    struct timeval timeout = {seconds, 0};
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+int daemon_serve(void (*render)(FILE *out, const struct Client *client, void *arg), void *arg) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if(socket_path(addr.sun_path, sizeof(addr.sun_path))) {
+        fputs("\033[31m\033[1mERROR\033[0m: the daemon socket path is too long!\n", stderr);
+        return 1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+        return 1;
+
+    // is there another daemon listening already?
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        fprintf(stderr, "\033[31m\033[1mERROR\033[0m: albafetch is already running as a daemon on %s!\n", addr.sun_path);
+        close(fd);
+        return 1;
+    }
+    close(fd);
+
+    if((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return 1;
+
+    unlink(addr.sun_path);  // left behind by a daemon that did not exit cleanly
+
+    // only the user running the daemon should be able to connect
+    mode_t old_mask = umask(077);
+    int error = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_mask);
+
+    if(error || listen(fd, 64)) {
+        fprintf(stderr, "\033[31m\033[1mERROR\033[0m: could not listen on %s!\n", addr.sun_path);
+        close(fd);
+        return 1;
+    }
+
+    // a client going away mid-reply should not kill the daemon
+    signal(SIGPIPE, SIG_IGN);
+
+    strcpy(listening_path, addr.sun_path);
+    signal(SIGINT, stop_daemon);
+    signal(SIGTERM, stop_daemon);
+
+    while(1) {
+        int client = accept(fd, NULL, NULL);
+        if(client < 0) {
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break;
+        }
+
+        set_timeouts(client, 1);
+
+        struct Client request = {0};
+        char *buf = NULL;
+
+        if(read_client(client, &request, &buf) == 0) {
+            char *frame = NULL;
+            size_t len = 0;
+            FILE *out = open_memstream(&frame, &len);
+
+            if(out) {
+                render(out, &request, arg);
+                fclose(out);
+
+                write_all(client, frame, len);
+            }
+
+            free(frame);
+        }
+
+        free(request.env);
+        free(buf);
+        close(client);
+    }
+
+    close(fd);
+    unlink(addr.sun_path);
+
+    return 1;
+}
+
+int daemon_client(struct Request *request) {
+    struct sockaddr_un addr;
+    struct stat st;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if(socket_path(addr.sun_path, sizeof(addr.sun_path)))
+        return 1;
+
+    // the socket might be in /tmp, make sure it was not put there by someone else
+    if(lstat(addr.sun_path, &st) || S_ISSOCK(st.st_mode) == 0 || st.st_uid != getuid())
+        return 1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+        return 1;
+
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        close(fd);
+        return 1;
+    }
+
+    set_timeouts(fd, 5);
+
+    // the modules that depend on the client are ran for it
+    char cwd[PATH_MAX];
+    if(getcwd(cwd, sizeof(cwd)) == NULL)
+        cwd[0] = 0;
+
+    size_t env_len = 0;
+    for(char **var = environ; var && *var; ++var)
+        env_len += strlen(*var) + 1;
+
+    // the daemon would refuse it, a normal run can still deal with it
+    if(env_len > DAEMON_MAX_ENV) {
+        close(fd);
+        return 1;
+    }
+
+    request->parent = getppid();
+    request->cwd_len = (unsigned)strlen(cwd);
+    request->env_len = (unsigned)env_len;
+
+    int error = write_all(fd, (char *)request, sizeof(*request)) || write_all(fd, cwd, request->cwd_len);
+    for(char **var = environ; error == 0 && var && *var; ++var)
+        error = write_all(fd, *var, strlen(*var) + 1);
+
+    if(error) {
+        close(fd);
+        return 1;
+    }
+
+    char buf[4096];
+    ssize_t got;
+    size_t total = 0;
+
+    while((got = read(fd, buf, sizeof(buf))) != 0) {
+        if(got < 0) {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+
+        if(write_all(STDOUT_FILENO, buf, (size_t)got))
+            break;
+        total += (size_t)got;
+    }
+
+    close(fd);
+
+    // nothing came back, the caller can still do a normal run
+    return total == 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/*
+ * albafetch --daemon keeps the parsed config, the logo and the module
+ * outputs in memory and listens on a unix socket
+ * ($XDG_RUNTIME_DIR/albafetch.sock, or /tmp/albafetch-UID.sock).
+ * albafetch --client sends its terminal width, flags, environment,
+ * working directory and parent there and prints whatever frame it gets
+ * back, without parsing anything on its own.
+ */
+
+// flags sent by the client
+#define DAEMON_NO_LOGO      0x1
+#define DAEMON_BOLD_ON      0x2
+#define DAEMON_BOLD_OFF     0x4
+#define DAEMON_ALIGN_ON     0x8
+#define DAEMON_ALIGN_OFF    0x10
+
+// the biggest environment a client may send
+#define DAEMON_MAX_ENV (256 * 1024)
+
+// what a client sends, followed by cwd_len bytes of working directory and env_len of environment
+struct Request {
+    unsigned width;
+    unsigned flags;
+    char logo[32];      // --logo, empty if it was not used
+    char color[16];     // --color, empty if it was not used
+    pid_t parent;       // the parent of the client (usually its shell)
+    unsigned cwd_len;
+    unsigned env_len;   // "NAME=value\0" for every variable
+};
+
+// what the daemon renders a frame for
+struct Client {
+    struct Request request;
+    char *cwd;          // NULL if the client could not tell
+    char **env;         // NULL terminated
+};
+
+/*
+ * Serve clients until albafetch gets killed, rendering every frame
+ * with render(). Returns 1 if the socket could not be set up.
+ */
+int daemon_serve(void (*render)(FILE *out, const struct Client *client, void *arg), void *arg);
+
+/* ask a running daemon for a frame and print it, 0 on success
+ * the parent, the working directory and the environment of request are filled in
+ */
+int daemon_client(struct Request *request);
+
+#endif // DAEMON_H
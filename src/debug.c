@@ -7,6 +7,7 @@
 #include <sys/time.h>
 
 #include "info/info.h"
+#include "context.h"
 #include "utils.h"
 
 // Most of those aren't even needed
@@ -14,7 +15,7 @@ struct Config config;
 
 int main(int argc, char **argv) {
     struct Module {
-        int (*func)(char *);
+        int (*func)(char *, struct Context *);
         char *name;
     };
     struct Module arr[] = {
@@ -34,6 +35,7 @@ int main(int argc, char **argv) {
         {host, "host"},
         {bios, "bios"},
         {cpu, "cpu"},
+        {isa, "isa"},
         {gpu, "gpu"},
         {memory, "memory"},
         {public_ip, "public_ip"},
@@ -61,12 +63,15 @@ int main(int argc, char **argv) {
     strcpy(config.col_block_str, "   ");
     strcpy(config.date_format, "%02d/%02d/%d %02d:%02d:%02d");
 
+    struct Context ctx;
+    context_init(&ctx);
+
     gettimeofday(&start_all, NULL);
 
     for(unsigned long i = 0; i < sizeof(arr)/sizeof(arr[0]); ++i) {
         gettimeofday(&start, NULL);
 
-        return_value = arr[i].func(mem);
+        return_value = arr[i].func(mem, &ctx);
 
         gettimeofday(&end, NULL);
 
@@ -88,6 +93,8 @@ int main(int argc, char **argv) {
     time = ((end.tv_sec  - start_all.tv_sec) * 1e6 +
                  end.tv_usec - start_all.tv_usec) / 1e3;
 
+    context_destroy(&ctx);
+
     printf("\n\033[1mDebug run finished with a total of %u errors.\033[0m [\033[1m\033[36m\033[1m%.3f ms\033[0m]\n", errors, time);
     
     return 0;
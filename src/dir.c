@@ -0,0 +1,135 @@
+#include "dir.h"
+
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif // __linux__
+
+// "." and ".." are never counted
+static int is_dot(const char *name) {
+    return name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0));
+}
+
+#ifdef __linux__
+// what getdents64 fills the buffer with
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+long dir_list_buf(struct DirBuf *buf, const char *path,
+                  void (*func)(const char *name, const unsigned char type, void *arg), void *arg) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0)
+        return -1;
+
+    // aligned for the records in it, only used if buf is missing or almost used up
+    uint64_t fallback[512];
+    char *data = (char *)fallback;
+    size_t size = sizeof(fallback);
+
+    const struct DirBuf saved = *buf;
+    if(buf->data && buf->size / 2 >= sizeof(fallback)) {
+        size = (buf->size / 2) & ~(size_t)7;
+        data = buf->data;
+
+        // what the walks nested in func can use
+        buf->data += size;
+        buf->size -= size;
+    }
+
+    long count = 0;
+    long got;
+
+    while((got = syscall(SYS_getdents64, fd, data, size)) > 0) {
+        for(long offset = 0; offset < got;) {
+            struct linux_dirent64 *entry = (struct linux_dirent64 *)(data + offset);
+            offset += entry->d_reclen;
+
+            if(is_dot(entry->d_name))
+                continue;
+
+            ++count;
+            if(func)
+                func(entry->d_name, entry->d_type, arg);
+        }
+    }
+
+    close(fd);
+    *buf = saved;
+
+    return count;
+}
+
+long dir_list(const char *path, void (*func)(const char *name, const unsigned char type, void *arg), void *arg) {
+    struct DirBuf buf;
+    dir_buf_init(&buf);
+
+    const long count = dir_list_buf(&buf, path, func, arg);
+    dir_buf_free(&buf);
+
+    return count;
+}
+
+int dir_buf_init(struct DirBuf *buf) {
+    buf->data = malloc(DIR_BUF_SIZE);
+    buf->size = buf->data ? DIR_BUF_SIZE : 0;
+
+    return buf->data == NULL;
+}
+
+void dir_buf_free(struct DirBuf *buf) {
+    free(buf->data);
+    buf->data = NULL;
+    buf->size = 0;
+}
+#else
+long dir_list(const char *path, void (*func)(const char *name, const unsigned char type, void *arg), void *arg) {
+    DIR *dir = opendir(path);
+    if(dir == NULL)
+        return -1;
+
+    struct dirent *entry;
+    long count = 0;
+
+    while((entry = readdir(dir))) {
+        if(is_dot(entry->d_name))
+            continue;
+
+        ++count;
+        if(func)
+            func(entry->d_name, entry->d_type, arg);
+    }
+
+    closedir(dir);
+
+    return count;
+}
+
+// readdir() has a buffer of its own
+long dir_list_buf(struct DirBuf *buf, const char *path,
+                  void (*func)(const char *name, const unsigned char type, void *arg), void *arg) {
+    (void)buf;
+
+    return dir_list(path, func, arg);
+}
+
+int dir_buf_init(struct DirBuf *buf) {
+    buf->data = NULL;
+    buf->size = 0;
+
+    return 0;
+}
+
+void dir_buf_free(struct DirBuf *buf) {
+    (void)buf;
+}
+#endif // __linux__
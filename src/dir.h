@@ -0,0 +1,44 @@
+#pragma once
+
+#ifndef DIR_H
+#define DIR_H
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <stddef.h>
+
+// what a top-level walk allocates, every nested walk reads into half of what's left
+#define DIR_BUF_SIZE (128 * 1024)
+
+// a buffer shared by a walk and the walks nested in it
+struct DirBuf {
+    char *data;
+    size_t size;
+};
+
+/*
+ * Call func(name, type, arg) for every entry of the directory at path,
+ * except "." and "..". type is one of the DT_* values from dirent.h
+ * (DT_UNKNOWN if the filesystem does not tell). func may be NULL.
+ * On Linux the entries are read with getdents64 into a 64 KiB buffer on the heap,
+ * so that even big directories only take a few syscalls.
+ * Returns the number of entries, or -1 if path could not be opened.
+ */
+long dir_list(const char *path, void (*func)(const char *name, const unsigned char type, void *arg), void *arg);
+
+/*
+ * Like dir_list(), but reading into half of buf, while func gets the other half:
+ * walks nested in func should pass the same buf, so that a whole tree is walked
+ * with a single allocation (and without big buffers on the stack).
+ */
+long dir_list_buf(struct DirBuf *buf, const char *path,
+                  void (*func)(const char *name, const unsigned char type, void *arg), void *arg);
+
+// allocate buf for a walk, 0 on success (dir_list_buf() still works if it fails)
+int dir_buf_init(struct DirBuf *buf);
+
+// free the buffer of a walk
+void dir_buf_free(struct DirBuf *buf);
+
+#endif // DIR_H
@@ -0,0 +1,204 @@
+#include "gvdb.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define HEADER_SIZE 24
+#define ITEM_SIZE   24
+#define NO_PARENT   0xffffffffu
+
+// keys are stored as a chain of parents ("/", "org/", "gnome/"...), a loop in a corrupted file could be endless
+#define MAX_DEPTH 64
+
+struct Table {
+    const uint8_t *map;
+    size_t len;
+    const uint8_t *buckets;
+    uint32_t bucket_count;
+    const uint8_t *items;
+    uint32_t item_count;
+};
+
+// the tables are always little endian, only the values can be byteswapped
+static uint32_t read_le16(const uint8_t *ptr) {
+    return (uint32_t)ptr[0] | (uint32_t)ptr[1] << 8;
+}
+
+static uint32_t read_le32(const uint8_t *ptr) {
+    return (uint32_t)ptr[0] | (uint32_t)ptr[1] << 8 | (uint32_t)ptr[2] << 16 | (uint32_t)ptr[3] << 24;
+}
+
+static uint32_t hash_key(const char *key) {
+    uint32_t hash = 5381;
+
+    while(*key)
+        hash = hash * 33 + (uint32_t)(int32_t)(signed char)*key++;
+
+    return hash;
+}
+
+// whether item (and its parents) spell out the first len bytes of key
+static bool check_name(const struct Table *table, const uint8_t *item, const char *key, size_t len,
+                       const unsigned depth) {
+    if(depth > MAX_DEPTH)
+        return false;
+
+    const uint32_t start = read_le32(item + 8);
+    const uint32_t size = read_le16(item + 12);
+
+    if(size > len || start > table->len || size > table->len - start)
+        return false;
+
+    len -= size;
+    if(memcmp(key + len, table->map + start, size))
+        return false;
+
+    const uint32_t parent = read_le32(item + 4);
+    if(parent == NO_PARENT)
+        return len == 0;
+
+    if(parent >= table->item_count || size == 0)
+        return false;
+
+    return check_name(table, table->items + (size_t)parent * ITEM_SIZE, key, len, depth+1);
+}
+
+// set table up from the hash table between start and end, returns 1 if it doesn't fit there
+static int open_table(struct Table *table, const uint32_t start, const uint32_t end) {
+    if(start > end || end > table->len || end - start < 8)
+        return 1;
+
+    // a bloom filter, the buckets and the items
+    const size_t bloom_words = read_le32(table->map + start) & ((1u << 27) - 1);
+    table->bucket_count = read_le32(table->map + start + 4);
+
+    const size_t items = (size_t)start + 8 + (bloom_words + table->bucket_count) * 4;
+    if(items > end)
+        return 1;
+
+    table->buckets = table->map + start + 8 + bloom_words * 4;
+    table->items = table->map + items;
+    table->item_count = (uint32_t)((end - items) / ITEM_SIZE);
+
+    return 0;
+}
+
+/* find the item called key, of the given type ('v' for values, 'H' for nested tables)
+ * returns the start of what it points to and saves its end to end, NULL if it's not there
+ */
+static const uint8_t *lookup(const struct Table *table, const char *key, const char type, const uint8_t **end) {
+    if(table->bucket_count == 0 || table->item_count == 0)
+        return NULL;
+
+    const uint32_t hash = hash_key(key);
+    const uint32_t bucket = hash % table->bucket_count;
+
+    uint32_t item = read_le32(table->buckets + (size_t)bucket * 4);
+    uint32_t last = bucket == table->bucket_count-1 ? table->item_count
+                                                    : read_le32(table->buckets + (size_t)(bucket+1) * 4);
+    if(last > table->item_count)
+        last = table->item_count;
+
+    for(; item < last; ++item) {
+        const uint8_t *ptr = table->items + (size_t)item * ITEM_SIZE;
+
+        if(read_le32(ptr) != hash || ptr[14] != type || check_name(table, ptr, key, strlen(key), 0) == false)
+            continue;
+
+        const uint32_t start = read_le32(ptr + 16);
+        const uint32_t stop = read_le32(ptr + 20);
+        if(start > stop || stop > table->len)
+            return NULL;
+
+        *end = table->map + stop;
+        return table->map + start;
+    }
+
+    return NULL;
+}
+
+/* copy the string held by the serialized variant between value and end
+ * a variant is its content, a NUL and its type: "Adwaita\0" "\0" "s"
+ * schemas keep a tuple instead, with the default value first: "Adwaita\0" "\0" "(s)"
+ */
+static bool copy_string(const uint8_t *value, const uint8_t *end, char *dest, const size_t len) {
+    const uint8_t *type = end;
+    while(type > value && type[-1])
+        --type;
+
+    // the NUL before the type, which is "s" or a tuple starting with a string
+    if(type == value || len == 0
+       || ((end - type != 1 || type[0] != 's') && (end - type < 3 || type[0] != '(' || type[1] != 's')))
+        return false;
+
+    const size_t data_len = (size_t)(type - 1 - value);
+    const size_t str_len = strnlen((const char *)value, data_len);
+    if(str_len == data_len)     // not NUL terminated
+        return false;
+
+    const size_t copied = str_len < len ? str_len : len-1;
+
+    memcpy(dest, value, copied);
+    dest[copied] = 0;
+
+    return true;
+}
+
+size_t gvdb_strings(const char *path, const char *table_name, struct GvdbKey *keys, const size_t count) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return 0;
+
+    struct stat st;
+    if(fstat(fd, &st) || st.st_size < HEADER_SIZE) {
+        close(fd);
+        return 0;
+    }
+
+    struct Table table = {0};
+    table.len = (size_t)st.st_size;
+    table.map = mmap(NULL, table.len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(table.map == MAP_FAILED)
+        return 0;
+
+    size_t found = 0;
+
+    // the signature is "GVariant", or its byteswapped version
+    if(memcmp(table.map, "GVariant", 8) && memcmp(table.map, "raVGtnai", 8))
+        goto done;
+
+    // then the version, some options and the start and end of the root table
+    if(open_table(&table, read_le32(table.map + 16), read_le32(table.map + 20)))
+        goto done;
+
+    if(table_name) {
+        const uint8_t *end;
+        const uint8_t *nested = lookup(&table, table_name, 'H', &end);
+
+        if(nested == NULL || open_table(&table, (uint32_t)(nested - table.map), (uint32_t)(end - table.map)))
+            goto done;
+    }
+
+    for(size_t i = 0; i < count; ++i) {
+        if(keys[i].dest[0])
+            continue;
+
+        const uint8_t *end;
+        const uint8_t *value = lookup(&table, keys[i].key, 'v', &end);
+
+        if(value && copy_string(value, end, keys[i].dest, keys[i].len))
+            ++found;
+    }
+
+    done:
+    munmap((void *)table.map, table.len);
+
+    return found;
+}
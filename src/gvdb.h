@@ -0,0 +1,32 @@
+#pragma once
+
+#ifndef GVDB_H
+#define GVDB_H
+
+#define _GNU_SOURCE
+
+#include <stddef.h>
+
+/*
+ * A minimal, read-only reader for GVDB files, the hash tables dconf keeps
+ * its databases in (like ~/.config/dconf/user) and GSettings its compiled
+ * schemas (gschemas.compiled), which only knows how to look up string values.
+ * https://gitlab.gnome.org/GNOME/gvdb/-/blob/main/gvdb/gvdb-format.h
+ */
+
+struct GvdbKey {
+    const char *key;    // name of the key ("/org/gnome/desktop/interface/gtk-theme" in dconf)
+    char *dest;         // where the value is copied, skipped if it's not empty
+    size_t len;         // size of dest
+};
+
+/*
+ * Look for every key in the GVDB file at path, mapping it once.
+ * Keys are looked up in the root table, or in the nested table called
+ * table_name ("org.gnome.desktop.interface" in a schema) if it's not NULL.
+ * Only strings are copied (or the default value of a schema key, if it's one).
+ * Returns how many of them were found.
+ */
+size_t gvdb_strings(const char *path, const char *table_name, struct GvdbKey *keys, const size_t count);
+
+#endif // GVDB_H
@@ -6,7 +6,9 @@
 #include <string.h>
 
 // get the battery percentage and status (Linux only!)
-int battery(char *dest) {
+int battery(char *dest, struct Context *ctx) {
+    (void)ctx;
+
     char capacity[5] = "";
     char status[20] = "";
     
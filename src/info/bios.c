@@ -6,7 +6,9 @@
 #include <stdlib.h>
 
 // get the current BIOS vendor and version (Linux only!)
-int bios(char *dest) {
+int bios(char *dest, struct Context *ctx) {
+    (void)ctx;
+
     char *vendor = NULL, *version = NULL;
     FILE *fp = NULL;
     size_t len;
@@ -6,7 +6,9 @@
 #include <stdio.h>
 
 // show the terminal color configuration
-int colors(char *dest) {
+int colors(char *dest, struct Context *ctx) {
+    (void)ctx;
+
     memset(dest, 0, 256);
     
     for(int i = 0; i < 8; ++i)
@@ -1,4 +1,5 @@
 #include "info.h"
+#include "../keyval.h"
 #include "../utils.h"
 
 #include <string.h>
@@ -8,14 +9,166 @@
 
 #ifdef __APPLE__
 #include <sys/sysctl.h>
+#else
+#include "../dir.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#endif // __APPLE__
+
+#ifndef __APPLE__
+// count the cpus in a list like "0-3,8-11", as found in /sys/devices/system/cpu/online
+static int count_cpus(const char *list) {
+    int count = 0;
+
+    while(*list >= '0' && *list <= '9') {
+        char *end;
+        const long first = strtol(list, &end, 10);
+        long last = first;
+
+        if(*end == '-')
+            last = strtol(end+1, &end, 10);
+
+        if(last >= first)
+            count += (int)(last - first + 1);
+
+        if(*end != ',')
+            break;
+        list = end+1;
+    }
+
+    return count;
+}
+
+// the number of cpus that are online (or, failing that, that albafetch may run on)
+static int online_cpus(void) {
+    char buf[1024];
+
+    if(keyval_read("/sys/devices/system/cpu/online", buf, sizeof(buf)) > 0) {
+        const int count = count_cpus(buf);
+        if(count)
+            return count;
+    }
+
+    cpu_set_t set;
+    if(sched_getaffinity(0, sizeof(set), &set) == 0)
+        return CPU_COUNT(&set);
+
+    return 0;
+}
+
+// read a number from the file name in the directory dirfd, 0 if it can't
+static unsigned long read_at(const int dirfd, const char *name) {
+    int fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return 0;
+
+    char buf[32];
+    const ssize_t got = read(fd, buf, sizeof(buf)-1);
+    close(fd);
+
+    if(got <= 0)
+        return 0;
+    buf[got] = 0;
+
+    return strtoul(buf, NULL, 10);
+}
+
+// the highest clock of every kind of core, in 100 MHz steps
+struct Clocks {
+    int dirfd;              // /sys/devices/system/cpu/cpufreq
+    unsigned long steps[8];
+    size_t count;
+};
+
+/* every cpufreq policy covers a cluster of cpus that run at the same clock,
+ * so on hybrid cpus performance and efficiency cores end up in different ones
+ */
+static void add_policy(const char *name, const unsigned char type, void *arg) {
+    (void)type;
+
+    struct Clocks *clocks = arg;
+
+    if(strncmp(name, "policy", 6))
+        return;
+
+    int fd = openat(clocks->dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0)
+        return;
+
+    unsigned long khz = read_at(fd, "cpuinfo_max_freq");
+    if(khz == 0)
+        khz = read_at(fd, "scaling_max_freq");
+    close(fd);
+
+    // rounded, so that cores of the same kind that boost slightly differently count as one
+    const unsigned long step = (khz + 50000) / 100000;
+    if(step == 0)
+        return;
+
+    for(size_t i = 0; i < clocks->count; ++i)
+        if(clocks->steps[i] == step)
+            return;
+
+    if(clocks->count < sizeof(clocks->steps)/sizeof(clocks->steps[0]))
+        clocks->steps[clocks->count++] = step;
+}
+
+// write the highest clock of every kind of core to dest (" @ 4.7/3.5 GHz"), 0 on success
+static int max_clocks(char *dest, const size_t len) {
+    struct Clocks clocks;
+
+    clocks.count = 0;
+    clocks.dirfd = open("/sys/devices/system/cpu/cpufreq", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(clocks.dirfd < 0)
+        return 1;
+
+    dir_list("/sys/devices/system/cpu/cpufreq", add_policy, &clocks);
+    close(clocks.dirfd);
+
+    if(clocks.count == 0)
+        return 1;
+
+    // fastest first
+    for(size_t i = 1; i < clocks.count; ++i)
+        for(size_t j = i; j > 0 && clocks.steps[j] > clocks.steps[j-1]; --j) {
+            const unsigned long tmp = clocks.steps[j];
+            clocks.steps[j] = clocks.steps[j-1];
+            clocks.steps[j-1] = tmp;
+        }
+
+    size_t used = (size_t)snprintf(dest, len, " @ ");
+    for(size_t i = 0; i < clocks.count && used < len; ++i)
+        used += (size_t)snprintf(dest+used, len-used, "%s%g", i ? "/" : "", (float)clocks.steps[i] / 10);
+    if(used < len)
+        snprintf(dest+used, len-used, " GHz");
+
+    return 0;
+}
+
+// skip what's between a cpuinfo key and its value ("\t\t: ")
+static const char *cpuinfo_value(const struct KeyVal *key) {
+    const char *colon = memchr(key->value, ':', key->len);
+    if(colon == NULL)
+        return NULL;
+
+    ++colon;
+    while(colon < key->value + key->len && *colon == ' ')
+        ++colon;
+
+    return colon;
+}
 #endif // __APPLE__
 
 // get the cpu name and frequency
-int cpu(char *dest) {
+int cpu(char *dest, struct Context *ctx) {
+    (void)ctx;
+
     char *cpu_info;
     char *end;
     int count = 0;
-    char freq[24] = "";
+    char freq[48] = "";
 
     #ifdef __APPLE__
         size_t BUF_SIZE = 256;
@@ -35,67 +188,52 @@ int cpu(char *dest) {
 
         cpu_info = buf;
     #else
-    FILE *fp = fopen("/proc/cpuinfo", "r");
-    if(fp == NULL)
-        return 1;
+        /* /proc/cpuinfo has a stanza for every thread, and the kernel has to ask each
+         * of them for its current clock to generate it, so only the beginning is read
+         * (the first stanza, with all that's needed, is just a few hundred bytes long)
+         */
+        char buf[4096];
+        long len = keyval_read("/proc/cpuinfo", buf, sizeof(buf));
+        if(len <= 0)
+            return 1;
 
-    char *buf = malloc(0x10001);
-    buf[fread(buf, 1, 0x10000, fp)] = 0;
-    fclose(fp);
+        const char *stanza_end = memmem(buf, (size_t)len, "\n\n", 2);
+        if(stanza_end)
+            len = stanza_end - buf;
 
-    cpu_info = buf;
-    if(cpu_count) {
-        end = cpu_info;
-        while((end = strstr(end, "processor"))) {
-            ++count;
-            ++end;
-        }
-    }
+        struct KeyVal keys[] = {
+            {"model name", NULL, 0},
+            {"cpu MHz", NULL, 0},
+        };
+        keyval_find(buf, (size_t)len, keys, 2);
 
-    cpu_info = strstr(cpu_info, "model name");
-    if(cpu_info == NULL) {
-        return 1;
-        free(cpu_info);
-    }
+        const char *model = keys[0].value ? cpuinfo_value(keys + 0) : NULL;
+        if(model == NULL)
+            return 1;
 
-    cpu_info += 13;
+        char name[256];
+        const size_t name_len = (size_t)(keys[0].value + keys[0].len - model);
+        memcpy(name, model, name_len < sizeof(name) ? name_len : sizeof(name)-1);
+        name[name_len < sizeof(name) ? name_len : sizeof(name)-1] = 0;
 
-    end = strstr(cpu_info, " @");
-    if(end)
-        *end = 0;
-    else {
-        end = strchr(cpu_info, '\n');
-        if(end == NULL) {
-            return 1;
-            free(cpu_info);
-        }
-            
-        *end = 0;
-    }
+        if((end = strstr(name, " @")))
+            *end = 0;
 
-    /* I might eventually add an option to get the "default" clock speed
-     * by parsing one or more of the following files:
-     * - /sys/devices/system/cpu/cpu0/cpufreq/cpupower_max_freq
-     * - /sys/devices/system/cpu/cpu0/cpufreq/scaling_max_freq
-     * - /sys/devices/system/cpu/cpu0/cpufreq/bios_limit
-     * - /sys/devices/system/cpu/cpu0/cpufreq/base_frequency
-     */
-    // Printing the clock frequency the first thread is currently running at
-    ++end;
-    char *frequency = strstr(end, "cpu MHz");
-    if(frequency && cpu_freq) {
-        frequency = strchr(frequency, ':');
-        if(frequency) {
-            frequency += 2;
-
-            end = strchr(frequency, '\n');
-            if(end) {
-                *end = 0;
+        cpu_info = name;
 
-                snprintf(freq, 24, " @ %g GHz", (float)(atoi(frequency)/100) / 10);
-            }
+        // the threads are counted from the list of online cpus, which does not depend on how many there are
+        if(cpu_count)
+            count = online_cpus();
+
+        /* with cpu_max_freq, the highest clock of every kind of core (from cpufreq),
+         * otherwise (or if cpufreq is not there) the one the first thread is currently running at
+         */
+        if(cpu_freq && ((cpu_max_freq) == 0 || max_clocks(freq, sizeof(freq)))) {
+            const char *frequency = keys[1].value ? cpuinfo_value(keys + 1) : NULL;
+
+            if(frequency)
+                snprintf(freq, sizeof(freq), " @ %g GHz", (float)(atoi(frequency)/100) / 10);
         }
-    }
     #endif
 
     // cleaning the string from various garbage
@@ -125,9 +263,6 @@ int cpu(char *dest) {
     }
 
     strncpy(dest, cpu_info, 256);
-    #ifdef __linux__
-        free(buf);
-    #endif
 
     if(freq[0])
         strncat(dest, freq, 255-strlen(dest));
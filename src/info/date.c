@@ -8,9 +8,12 @@
 
 
 // get the current date and time
-int date(char *dest) {
+int date(char *dest, struct Context *ctx) {
+    (void)ctx;
+
     time_t t = time(NULL);
-    struct tm tm = *localtime(&t);
+    struct tm tm;
+    localtime_r(&t, &tm);   // localtime() is not thread safe
     snprintf(dest, 256, config.date_format, tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
     return 0;
 }
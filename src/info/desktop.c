@@ -8,17 +8,19 @@
 #include <stdlib.h>
 
 // get the current desktop environment
-int desktop(char *dest) {
+int desktop(char *dest, struct Context *ctx) {
     #ifdef __APPLE__
+        (void)ctx;
+
         strcpy(dest, "Aqua");
     #else
-        char *desktop = getenv("SWAYSOCK") ? "Sway" :
-                            (desktop = getenv("XDG_CURRENT_DESKTOP")) ? desktop :
-                            (desktop = getenv("DESKTOP_SESSION")) ? desktop :
-                            getenv("KDE_SESSION_VERSION") ? "KDE" :
-                            getenv("GNOME_DESKTOP_SESSION_ID") ? "GNOME" :
-                            getenv("MATE_DESKTOP_SESSION_ID") ? "MATE" :
-                            getenv("TDE_FULL_SESSION") ? "Trinity" :
+        const char *desktop = ctx_getenv(ctx, "SWAYSOCK") ? "Sway" :
+                            (desktop = ctx_getenv(ctx, "XDG_CURRENT_DESKTOP")) ? desktop :
+                            (desktop = ctx_getenv(ctx, "DESKTOP_SESSION")) ? desktop :
+                            ctx_getenv(ctx, "KDE_SESSION_VERSION") ? "KDE" :
+                            ctx_getenv(ctx, "GNOME_DESKTOP_SESSION_ID") ? "GNOME" :
+                            ctx_getenv(ctx, "MATE_DESKTOP_SESSION_ID") ? "MATE" :
+                            ctx_getenv(ctx, "TDE_FULL_SESSION") ? "Trinity" :
                             // strcmp("linux", getenv("TERM") == 0 ? "none" :      // running in tty
                             NULL;
         if(desktop == NULL)
@@ -27,15 +29,14 @@ int desktop(char *dest) {
         strcpy(dest, desktop);
 
         if(de_type) {
-            if(getenv("WAYLAND_DISPLAY"))
+            if(ctx_getenv(ctx, "WAYLAND_DISPLAY"))
                 strncat(dest, " (Wayland)", 255-strlen(dest));
-            else if((desktop = getenv("XDG_SESSION_TYPE"))) {
+            else if((desktop = ctx_getenv(ctx, "XDG_SESSION_TYPE"))) {
                 if(desktop[0] == 0)
                     return 0;
-                desktop[0] = toupper(desktop[0]);
                 
                 char buf[32];
-                snprintf(buf, 32, " (%s) ", desktop);
+                snprintf(buf, 32, " (%c%s) ", toupper(desktop[0]), desktop+1);
                 strncat(dest, buf, 255-strlen(dest));
             }
         }
@@ -12,163 +12,183 @@
 #include "../macos_infos.h"
 #else
 #ifndef __ANDROID__
+#include "../dir.h"
+#include "../keyval.h"
+#include "../pciids.h"
+
+#include <limits.h>
+#include <stdio.h>
 #include <pci/pci.h>
 #endif // __ANDROID__
 #endif // __APPLE__
 
-// get the gpu name(s)
-int gpu(char *dest) {
-    char *gpus[] = {NULL, NULL, NULL};
+#if !defined(__APPLE__) && !defined(__ANDROID__)
+// a display controller found in sysfs
+struct Gpu {
+    char address[16];   // e.g. "0000:01:00.0"
+    unsigned vendor;
+    unsigned device;
+};
+
+struct GpuList {
+    struct Gpu *gpus;
+    size_t count;
+    size_t size;
+};
+
+// read a sysfs attribute holding a hex number ("0x030000"), 0 on success
+static int read_hex(const char *device, const char *attribute, unsigned *dest) {
+    char path[PATH_MAX], buf[32];
     char *end;
 
+    snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/%s", device, attribute);
+    if(keyval_read(path, buf, sizeof(buf)) <= 0)
+        return 1;
+
+    *dest = (unsigned)strtoul(buf, &end, 16);
+
+    return end == buf;
+}
+
+// save the device if it's a VGA compatible (0x0300) or 3D (0x0302) controller
+static void add_gpu(const char *name, const unsigned char type, void *arg) {
+    (void)type;     // every entry is a link to the actual device
+
+    struct GpuList *list = arg;
+    unsigned device_class;
+    struct Gpu gpu;
+
+    if(strlen(name) >= sizeof(gpu.address)
+       || read_hex(name, "class", &device_class)
+       || ((device_class >> 8) != 0x0300 && (device_class >> 8) != 0x0302)
+       || read_hex(name, "vendor", &gpu.vendor)
+       || read_hex(name, "device", &gpu.device))
+        return;
+
+    strcpy(gpu.address, name);
+
+    if(list->count == list->size) {
+        size_t size = list->size ? list->size*2 : 4;
+        struct Gpu *gpus = realloc(list->gpus, size * sizeof(*gpus));
+        if(gpus == NULL)
+            return;
+
+        list->gpus = gpus;
+        list->size = size;
+    }
+
+    list->gpus[list->count++] = gpu;
+}
+
+// in bus order, which is not the order the directory lists them in
+static int compare_gpus(const void *a, const void *b) {
+    return strcmp(((const struct Gpu *)a)->address, ((const struct Gpu *)b)->address);
+}
+#endif
+
+// shorten the name of a gpu and append it to dest
+static void append_gpu(char *dest, char *gpu) {
+    char *end;
+
+    if((gpu_brand) == 0) {
+        if(strstr(gpu, "Intel ")
+           || strstr(gpu, "Apple "))
+            gpu += 6;
+        else if(strstr(gpu, "AMD "))
+            gpu += 4;
+    }
+
+    if((end = strchr(gpu, '['))) {   // sometimes the gpu is "Architecture [GPU Name]"
+        char *ptr = strchr(end, ']');
+        if(ptr) {
+            gpu = end+1;
+            *ptr = 0;
+        }
+    }
+
+    if((end = strstr(gpu, " Integrated Graphics Controller")))
+        *end = 0;
+    if((end = strstr(gpu, " Rev. ")))
+        *end = 0;
+
+    if(dest[0])
+        strncat(dest, ", ", 255-strlen(dest));
+    strncat(dest, gpu, 255-strlen(dest));
+}
+
+// get the gpu name(s)
+int gpu(char *dest, struct Context *ctx) {
+    dest[0] = 0;
+
     #ifdef __APPLE__
-        struct utsname name;
-        uname(&name);
+        char *model = NULL;
+        const struct utsname *name = ctx_uname(ctx);
+        const bool x86_64 = name && strcmp(name->machine, "x86_64") == 0;
 
-        if(strcmp(name.machine, "x86_64") == 0)
-            gpus[0] = get_gpu_string();  // only works on x64
-        if(gpus[0] == 0 || strcmp(name.machine, "x86_64")) {     // fallback
+        if(x86_64)
+            model = get_gpu_string();  // only works on x64
+        if(model == 0 || x86_64 == false) {     // fallback
             char buf[1024];
             char *args[] = {"/usr/sbin/system_profiler", "SPDisplaysDataType", NULL};
             exec_cmd(buf, 1024, args);
 
-            gpus[0] = strstr(buf, "Chipset Model: ");
-            if(gpus[0] == 0)
+            model = strstr(buf, "Chipset Model: ");
+            if(model == 0)
                 return 1;
-            gpus[0] += 15;
-            char *end = strchr(gpus[0], '\n');
+            model += 15;
+            char *end = strchr(model, '\n');
             if(end == NULL)
                 return 1;
             *end = 0;
         }
+
+        append_gpu(dest, model);
     #else
+        (void)ctx;
+
     # ifdef __ANDROID__
         return 1;
     # else
-        // based on https://github.com/pciutils/pciutils/blob/master/example.c
-        char device_class[256], namebuf[768];
-        struct pci_dev *dev;
-        struct pci_access *pacc = pci_alloc();		// get the pci_access structure;
-
-        pci_init(pacc);		// initialize the PCI library
-        pci_scan_bus(pacc);		// we want to get the list of devices
-
-        int i = 0;
-
-        for(dev=pacc->devices; dev; dev=dev->next)	{ // iterates over all devices
-            pci_fill_info(dev, PCI_FILL_IDENT | PCI_FILL_BASES | PCI_FILL_CLASS);	// fill in header info
-
-            pci_lookup_name(pacc, device_class, 256, PCI_LOOKUP_CLASS, dev->device_class);
-            if(strcmp(device_class, "VGA compatible controller") == 0 || strcmp(device_class, "3D controller") == 0) {
-                // look up the full name of the device
-                if(config.gpu_index == 0) {
-                    gpus[i] = pci_lookup_name(pacc, namebuf+i*256, 256, PCI_LOOKUP_DEVICE, dev->vendor_id, dev->device_id);
-                    
-                    if(i < 2)
-                        ++i;
-                    else
-                        break;
-                }
-                else {
-                    if(i == config.gpu_index-1) {
-                        gpus[0] = pci_lookup_name(pacc, namebuf, 256, PCI_LOOKUP_DEVICE, dev->vendor_id, dev->device_id);
-                        break;
-                    }
-
-                    if(i < 2)
-                        ++i;
-                    else
-                        break;
-                }
-            }
+        /* the display controllers are told apart by their class in sysfs,
+         * and their names come from an index of pci.ids (libpci only tells where that is,
+         * and looks them up itself if the index can't be used)
+         */
+        struct GpuList list = {NULL, 0, 0};
+        dir_list("/sys/bus/pci/devices", add_gpu, &list);
+
+        if(list.count == 0 || (size_t)config.gpu_index > list.count) {
+            free(list.gpus);
+            return 1;
         }
 
-        pci_cleanup(pacc);  // close everything
-
-        // fallback (will only get 1 gpu)
+        qsort(list.gpus, list.count, sizeof(list.gpus[0]), compare_gpus);
 
-        char gpu[256];
+        struct pci_access *pacc = pci_alloc();
+        bool initialized = false;
 
-        if(gpus[0] == 0) {
-            if(config.gpu_index > 1)   // lol why would you choose a non-existing GPU
-                return 1;
+        for(size_t i = 0; i < list.count; ++i) {
+            if(config.gpu_index && i != (size_t)config.gpu_index-1)
+                continue;
 
-            char *lspci = malloc(0x2000);
-            char *args[] = {"lspci", "-mm", NULL};
-            exec_cmd(lspci, 0x2000, args);
-
-            gpus[0] = strstr(lspci, "3D");
-            if(gpus[0] == 0) {
-                gpus[0] = strstr(lspci, "VGA");
-                if(gpus[0] == 0) {
-                    free(lspci);
-                    return 1;
-                }
+            char name[256];
+            if(pciids_lookup(pacc->id_file_name, list.gpus[i].vendor, list.gpus[i].device, name, sizeof(name)) == 0) {
+                append_gpu(dest, name);
+                continue;
             }
 
-            for(int j = 0; j < 4; ++j) {
-                gpus[0] = strchr(gpus[0], '"');
-                if(gpus[0] == 0) {
-                    free(lspci);
-                    return 1;
-                }
-                ++gpus[0];
-
-                /* class" "manufacturer" "name"
-                 *  "manufacturer" "name"
-                 * manufacturer" "name"
-                 *  "name"
-                 * name"
-                 */
+            if(initialized == false) {
+                pci_init(pacc);
+                initialized = true;
             }
 
-            end = strchr(gpus[0], '"');   // name
-            if(end == NULL) {
-                free(lspci);
-                return 1;
-            }
-            *end = 0;
-            
-            strncpy(gpu, gpus[0], 255);
-            free(lspci);
-            gpus[0] = gpu;
+            if(pci_lookup_name(pacc, name, sizeof(name), PCI_LOOKUP_DEVICE, list.gpus[i].vendor, list.gpus[i].device))
+                append_gpu(dest, name);
         }
+
+        pci_cleanup(pacc);
+        free(list.gpus);
     # endif // __ANDROID__
     #endif // __APPLE__
 
-    if(gpus[0] == 0)
-        return 1;
-
-    // this next part is just random cleanup
-    // also, I'm using end as a random char* - BaD pRaCtIcE aNd CoNfUsInG - lol stfu
-    dest[0] = 0;    //  yk it's decent a yk it works
-    for(unsigned j = 0; j < sizeof(gpus)/sizeof(gpus[0]) && gpus[j%3]; ++j) {
-        if((gpu_brand) == 0) {
-            if(strstr(gpus[j], "Intel ")
-               || strstr(gpus[j], "Apple "))
-                gpus[j] += 6;
-            else if(strstr(gpus[j], "AMD "))
-                gpus[j] += 4;
-        }
-
-        if((end = strchr(gpus[j], '['))) {   // sometimes the gpu is "Architecture [GPU Name]"
-            char *ptr = strchr(end, ']');
-            if(ptr) {
-                gpus[j] = end+1;
-                *ptr = 0;
-            }
-        }
-        
-        if((end = strstr(gpus[j], " Integrated Graphics Controller")))
-            *end = 0;
-        if((end = strstr(gpus[j], " Rev. ")))
-            *end = 0;
-
-        // (finally) writing the GPUs into dest
-        if(j > 0)
-            strncat(dest, ", ", 256-strlen(dest));
-        strncat(dest, gpus[j], 256-strlen(dest));
-    }
-
-    return 0;
+    return dest[0] == 0;
 }
@@ -1,15 +1,10 @@
 #include "info.h"
-#include "../utils.h"
 
 #include <string.h>
 
-#include <stdlib.h>
-#include <unistd.h>
-#include <sys/wait.h>
-
 // get the current GTK Theme
-int gtk_theme(char *dest){ 
-    char *theme = getenv("GTK_THEME");
+int gtk_theme(char *dest, struct Context *ctx) {
+    const char *theme = ctx_getenv(ctx, "GTK_THEME");
 
     // try using GTK_THEME (faster)
     if(theme) {
@@ -18,27 +13,14 @@ int gtk_theme(char *dest){
         return 0;
     }
 
-    // try using gsettings (fallback)
-    // reading ~/.config/gtk-3.0/settings.ini could also be an option 
-    if(access("/bin/gsettings", F_OK) == 0){
-        char buf[256] = "";
-        char *args[] = {"gsettings", "get", "org.gnome.desktop.interface", "gtk-theme", NULL};
-        exec_cmd(buf, 256, args);
-
-        // cleanup
-        if(buf[0] != 0) {
-            if(buf[0] == '\'') {
-                strcpy(buf, buf+1);
+    // dconf, settings.ini or the schema defaults, gsettings as a fallback
+    const struct Themes *themes = ctx_themes(ctx);
+    if(themes == NULL || themes->gtk[0] == 0)
+        themes = ctx_themes_gsettings(ctx);
+    if(themes == NULL || themes->gtk[0] == 0)
+        return 1;
 
-                char *ptr = strchr(buf, '\'');
-                if(ptr)
-                    *ptr = 0;
-            }
-
-            strncpy(dest, buf, 256);
-            return 0;
-        }
-    }
+    strcpy(dest, themes->gtk);
 
-    return 1;
+    return 0;
 }
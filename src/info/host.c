@@ -11,12 +11,13 @@
 #include <sys/sysctl.h>
 #endif // __APPLE__
 #ifdef __ANDROID__
-#include <unistd.h>
-#include <sys/wait.h>
+#include "../proc.h"
 #endif // __ANDROID__
 
 // get the machine name and eventually model version
-int host(char *dest) {
+int host(char *dest, struct Context *ctx) {
+    (void)ctx;
+
     #ifdef __APPLE__
         size_t BUF_SIZE = 256;
         sysctlbyname("hw.model", dest, &BUF_SIZE, NULL, 0);
@@ -27,8 +28,14 @@ int host(char *dest) {
         char *model_args[] = {"getprop", "ro.product.model", NULL};
 
 
-        exec_cmd(brand, 64, brand_args);
-        exec_cmd(model, 64, model_args);
+        // both are started before waiting for either of them
+        struct Proc procs[] = {
+            {.argv = brand_args, .buf = brand, .len = 64, .timeout = PROC_TIMEOUT},
+            {.argv = model_args, .buf = model, .len = 64, .timeout = PROC_TIMEOUT},
+        };
+        proc_start(&procs[0]);
+        proc_start(&procs[1]);
+        proc_collect(procs, 2);
 
         if((brand[0] || model[0]) == 0)
             return 1;
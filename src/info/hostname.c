@@ -1,25 +1,17 @@
 #include "info.h"
 
-#define _GNU_SOURCE
-
 #include <string.h>
 
-#include <unistd.h>
-#include <limits.h>
+// print the machine hostname
+int hostname(char *dest, struct Context *ctx) {
+    const struct utsname *name = ctx_uname(ctx);
 
-// idk why but this is sometimes not defined
-#ifndef HOST_NAME_MAX
-    #ifdef _POSIX_HOST_NAME_MAX
-        #define HOST_NAME_MAX _POSIX_HOST_NAME_MAX
-    #else
-        #define HOST_NAME_MAX 255
-    #endif
-#endif
+    if(name == NULL)
+        return 1;
 
-// print the machine hostname
-int hostname(char *dest) {
-    char hostname[HOST_NAME_MAX + 1];
-    gethostname(hostname, HOST_NAME_MAX + 1);
+    // the hostname is the uname node name
+    char hostname[sizeof(name->nodename)];
+    strcpy(hostname, name->nodename);
 
     char *ptr = strstr(hostname, ".local");
     if(ptr)
@@ -3,54 +3,61 @@
 #ifndef INFO_H
 #define INFO_H
 
-int user(char *dest);
+#include "../context.h"
 
-int hostname(char *dest);
+// returned by modules whose output is incomplete: it's printed, but not cached
+#define INFO_PARTIAL 2
 
-int uptime(char *dest);
+int user(char *dest, struct Context *ctx);
 
-int os(char *dest);
+int hostname(char *dest, struct Context *ctx);
 
-int kernel(char *dest);
+int uptime(char *dest, struct Context *ctx);
 
-int desktop(char *dest);
+int os(char *dest, struct Context *ctx);
 
-int gtk_theme(char *dest);
+int kernel(char *dest, struct Context *ctx);
 
-int icon_theme(char *dest);
+int desktop(char *dest, struct Context *ctx);
 
-int cursor_theme(char *dest);
+int gtk_theme(char *dest, struct Context *ctx);
 
-int shell(char *dest);
+int icon_theme(char *dest, struct Context *ctx);
 
-int login_shell(char *dest);
+int cursor_theme(char *dest, struct Context *ctx);
 
-int term(char *dest);
+int shell(char *dest, struct Context *ctx);
 
-int packages(char *dest);
+int login_shell(char *dest, struct Context *ctx);
 
-int host(char *dest);
+int term(char *dest, struct Context *ctx);
 
-int bios(char *dest);
+int packages(char *dest, struct Context *ctx);
 
-int cpu(char *dest);
+int host(char *dest, struct Context *ctx);
 
-int gpu(char *dest);
+int bios(char *dest, struct Context *ctx);
 
-int memory(char *dest);
+int cpu(char *dest, struct Context *ctx);
 
-int public_ip(char *dest);
+int isa(char *dest, struct Context *ctx);
 
-int local_ip(char *dest);
+int gpu(char *dest, struct Context *ctx);
 
-int pwd(char *dest);
+int memory(char *dest, struct Context *ctx);
 
-int date(char *dest);
+int public_ip(char *dest, struct Context *ctx);
 
-int battery(char *dest);
+int local_ip(char *dest, struct Context *ctx);
 
-int colors(char *dest);
+int pwd(char *dest, struct Context *ctx);
 
-int light_colors(char *dest);
+int date(char *dest, struct Context *ctx);
+
+int battery(char *dest, struct Context *ctx);
+
+int colors(char *dest, struct Context *ctx);
+
+int light_colors(char *dest, struct Context *ctx);
 
 #endif // INFO_H
@@ -0,0 +1,258 @@
+#include "info.h"
+#include "../keyval.h"
+#include "../utils.h"
+
+#include <string.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define ISA_X86
+#endif
+
+#ifdef ISA_X86
+// an instruction set extension, as reported by cpuid
+struct Feature {
+    const char *name;
+    unsigned leaf;
+    unsigned subleaf;
+    int reg;            // 0-3 for eax, ebx, ecx, edx
+    unsigned bit;
+    unsigned long long xcr0;    // state the OS has to save for it to be usable
+};
+
+// the register state (XCR0) the OS saves on context switches, 0 if it can't tell
+static unsigned long long os_state(void) {
+    unsigned eax, ebx, ecx, edx;
+
+    // OSXSAVE
+    if(__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0 || (ecx & (1u << 27)) == 0)
+        return 0;
+
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+
+    return (unsigned long long)edx << 32 | eax;
+}
+
+// whether the cpu has feature, and the OS lets it be used
+static bool has_feature(const struct Feature *feature, const unsigned long long xcr0) {
+    unsigned regs[4];
+
+    if(__get_cpuid_count(feature->leaf, feature->subleaf, regs, regs+1, regs+2, regs+3) == 0)
+        return false;
+
+    return (regs[feature->reg] & (1u << feature->bit)) && (xcr0 & feature->xcr0) == feature->xcr0;
+}
+
+/* write the extensions that matter the most when picking build flags to dest
+ * with isa_compact, only the x86-64 microarchitecture level (and AMX) is written
+ */
+static void isa_features(char *dest, const size_t len) {
+    #define YMM 0x6ull      // SSE and AVX state
+    #define ZMM 0xe6ull     // AVX-512 state too
+    #define TMM 0x60000ull  // AMX tiles
+    const struct Feature features[] = {
+        {"SSE4.2", 1, 0, 2, 20, 0},
+        {"AES", 1, 0, 2, 25, 0},
+        {"SHA", 7, 0, 1, 29, 0},
+        {"AVX", 1, 0, 2, 28, YMM},
+        {"FMA", 1, 0, 2, 12, YMM},
+        {"AVX2", 7, 0, 1, 5, YMM},
+        {"AVX-VNNI", 7, 1, 0, 4, YMM},
+        {"AVX-512", 7, 0, 1, 16, ZMM},
+        {"AMX", 7, 0, 3, 24, TMM},
+    };
+    const unsigned long long xcr0 = os_state();
+
+    dest[0] = 0;
+
+    if(isa_compact) {
+        #ifdef __x86_64__
+            // what every x86-64 level needs on top of the previous one (roughly, the main extensions only)
+            const struct Feature levels[][5] = {
+                {   // v2
+                    {"SSE4.2", 1, 0, 2, 20, 0}, {"POPCNT", 1, 0, 2, 23, 0}, {"SSSE3", 1, 0, 2, 9, 0},
+                    {"CX16", 1, 0, 2, 13, 0}, {"SSE4.1", 1, 0, 2, 19, 0},
+                },
+                {   // v3
+                    {"AVX2", 7, 0, 1, 5, YMM}, {"FMA", 1, 0, 2, 12, YMM}, {"BMI1", 7, 0, 1, 3, 0},
+                    {"BMI2", 7, 0, 1, 8, 0}, {"MOVBE", 1, 0, 2, 22, 0},
+                },
+                {   // v4
+                    {"AVX512F", 7, 0, 1, 16, ZMM}, {"AVX512BW", 7, 0, 1, 30, ZMM}, {"AVX512CD", 7, 0, 1, 28, ZMM},
+                    {"AVX512DQ", 7, 0, 1, 17, ZMM}, {"AVX512VL", 7, 0, 1, 31, ZMM},
+                },
+            };
+
+            int level = 1;
+            for(size_t i = 0; i < sizeof(levels)/sizeof(levels[0]) && level == (int)i+1; ++i) {
+                bool complete = true;
+                for(size_t j = 0; j < sizeof(levels[0])/sizeof(levels[0][0]); ++j)
+                    if(has_feature(&levels[i][j], xcr0) == false)
+                        complete = false;
+
+                if(complete)
+                    ++level;
+            }
+
+            snprintf(dest, len, "x86-64-v%d", level);
+        #else
+            snprintf(dest, len, "i686");
+        #endif
+
+        if(has_feature(&features[sizeof(features)/sizeof(features[0])-1], xcr0))
+            strncat(dest, " AMX", len-strlen(dest)-1);
+
+        return;
+    }
+
+    for(size_t i = 0; i < sizeof(features)/sizeof(features[0]); ++i) {
+        if(has_feature(features + i, xcr0) == false)
+            continue;
+
+        if(dest[0])
+            strncat(dest, " ", len-strlen(dest)-1);
+        strncat(dest, features[i].name, len-strlen(dest)-1);
+    }
+
+    #undef YMM
+    #undef ZMM
+    #undef TMM
+}
+#else
+/* write the extensions that matter the most when picking build flags to dest,
+ * from the list of features in /proc/cpuinfo
+ */
+static void isa_features(char *dest, const size_t len) {
+    struct Flag {
+        const char *name;
+        const char *flag;
+    };
+    const struct Flag flags[] = {
+        // aarch64
+        {"NEON", "asimd"},
+        {"AES", "aes"},
+        {"SHA2", "sha2"},
+        {"CRC32", "crc32"},
+        {"LSE", "atomics"},
+        {"DotProd", "asimddp"},
+        {"SVE", "sve"},
+        {"SVE2", "sve2"},
+        {"SME", "sme"},
+        // 32 bit arm
+        {"NEON", "neon"},
+        {"VFPv4", "vfpv4"},
+    };
+
+    dest[0] = 0;
+
+    char buf[4096];
+    long read = keyval_read("/proc/cpuinfo", buf, sizeof(buf));
+    if(read <= 0)
+        return;
+
+    // only the first stanza is needed, every thread has the same flags
+    struct KeyVal keys[] = {
+        {"Features", NULL, 0},
+        {"flags", NULL, 0},
+    };
+    keyval_find(buf, (size_t)read, keys, 2);
+
+    const struct KeyVal *list = keys[0].value ? keys : keys + 1;
+    if(list->value == NULL)
+        return;
+
+    for(size_t i = 0; i < sizeof(flags)/sizeof(flags[0]); ++i) {
+        // every flag is surrounded by spaces (or the ':' and the end of the line)
+        const size_t flag_len = strlen(flags[i].flag);
+        const char *ptr = list->value, *end = list->value + list->len;
+        bool found = false;
+
+        while(ptr < end && (ptr = memmem(ptr, (size_t)(end - ptr), flags[i].flag, flag_len))) {
+            if((ptr[-1] == ' ' || ptr[-1] == ':' || ptr[-1] == '\t')
+               && (ptr + flag_len == end || ptr[flag_len] == ' ')) {
+                found = true;
+                break;
+            }
+
+            ptr += flag_len;
+        }
+
+        if(found == false || strstr(dest, flags[i].name))
+            continue;
+
+        if(dest[0])
+            strncat(dest, " ", len-strlen(dest)-1);
+        strncat(dest, flags[i].name, len-strlen(dest)-1);
+    }
+}
+#endif // ISA_X86
+
+// write the size of the caches of the first cpu to dest ("L1d 48K, L1i 32K, L2 2M, L3 30M")
+static void isa_caches(char *dest, const size_t len) {
+    dest[0] = 0;
+
+    for(int i = 0; i < 8; ++i) {
+        char path[64], level[8], type[16], size[16];
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", i);
+        if(keyval_read(path, level, sizeof(level)) <= 0)
+            break;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", i);
+        if(keyval_read(path, type, sizeof(type)) <= 0)
+            continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", i);
+        if(keyval_read(path, size, sizeof(size)) <= 0)
+            continue;
+
+        const int cache_level = atoi(level);
+        unsigned long kib = strtoul(size, NULL, 10);
+
+        // the L1 caches are left out of the compact format
+        if(kib == 0 || (isa_compact && cache_level < 2))
+            continue;
+
+        const char *suffix = "";
+        if(strncmp(type, "Data", 4) == 0)
+            suffix = "d";
+        else if(strncmp(type, "Instruction", 11) == 0)
+            suffix = "i";
+
+        char entry[32];
+        if(kib >= 1024 && kib % 1024 == 0)
+            snprintf(entry, sizeof(entry), "L%d%s %luM", cache_level, suffix, kib / 1024);
+        else if(kib >= 1024)
+            snprintf(entry, sizeof(entry), "L%d%s %.1fM", cache_level, suffix, (double)kib / 1024);
+        else
+            snprintf(entry, sizeof(entry), "L%d%s %luK", cache_level, suffix, kib);
+
+        if(dest[0])
+            strncat(dest, ", ", len-strlen(dest)-1);
+        strncat(dest, entry, len-strlen(dest)-1);
+    }
+}
+
+// get the instruction set extensions and the caches of the cpu
+int isa(char *dest, struct Context *ctx) {
+    (void)ctx;
+
+    char features[120], caches[120];
+
+    isa_features(features, sizeof(features));
+    isa_caches(caches, sizeof(caches));
+
+    if(features[0] && caches[0])
+        snprintf(dest, 256, "%s (%s)", features, caches);
+    else if(features[0])
+        strcpy(dest, features);
+    else if(caches[0])
+        strcpy(dest, caches);
+    else
+        return 1;
+
+    return 0;
+}
@@ -3,14 +3,19 @@
 
 #include <string.h>
 
-#include <sys/utsname.h>
 #include <stdio.h>
 
 // print the running kernel version (uname -r)
-int kernel(char *dest) {
-    struct utsname name;
-    uname(&name);
-    char *ptr = name.release, *type = NULL;
+int kernel(char *dest, struct Context *ctx) {
+    const struct utsname *name = ctx_uname(ctx);
+    if(name == NULL)
+        return 1;
+
+    // shortened below, so it can't be modified in place
+    char release[sizeof(name->release)];
+    strcpy(release, name->release);
+
+    char *ptr = release, *type = NULL;
     
     if(kernel_type) {
         while((ptr = strchr(ptr, '-')))
@@ -18,14 +23,14 @@ int kernel(char *dest) {
     }
 
     if(kernel_short) {
-        if((ptr = strchr(name.release, '-')))
+        if((ptr = strchr(release, '-')))
             *ptr = 0;
     }
 
     if(kernel_type && type)
-        snprintf(dest, 256, "%s (%s)", name.release, type);
+        snprintf(dest, 256, "%s (%s)", release, type);
     else
-        strncpy(dest, name.release, 256);
+        strncpy(dest, release, 256);
 
     return 0;
 }
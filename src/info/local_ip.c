@@ -8,7 +8,9 @@
 #include <arpa/inet.h>
 
 // get all local ips
-int local_ip(char *dest) {
+int local_ip(char *dest, struct Context *ctx) {
+    (void)ctx;
+
     struct ifaddrs *addrs=NULL;
     bool done = false;
     int buf_size = 256;
@@ -12,11 +12,16 @@
 #endif // __APPLE__
 
 // get the current login shell
-int login_shell(char *dest) {
-    char *buf = getenv("SHELL");
+int login_shell(char *dest, struct Context *ctx) {
+    const char *buf = ctx_getenv(ctx, "SHELL");
 
     if(buf && buf[0]) {
-        strncpy(dest, shell_path ? buf : basename(buf), 256);
+        // basename() may modify its argument
+        char path[256];
+        strncpy(path, buf, 255);
+        path[255] = 0;
+
+        strncpy(dest, shell_path ? path : basename(path), 256);
         return 0;
     }
 
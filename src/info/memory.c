@@ -1,5 +1,5 @@
 #include "info.h"
-#include "../queue.h"
+#include "../keyval.h"
 #include "../utils.h"
 
 #include <string.h>
@@ -9,12 +9,78 @@
 
 #ifdef __APPLE__
 #include "../macos_infos.h"
-#else
-#include <sys/sysinfo.h>
+#endif // __APPLE__
+
+#ifndef __APPLE__
+// what memory() needs from /proc/meminfo, in kB (hugepages are counted in pages)
+struct MemInfo {
+    unsigned long total;
+    unsigned long free;
+    unsigned long available;
+    unsigned long buffers;
+    unsigned long cached;
+    unsigned long shmem;
+    unsigned long reclaimable;
+    unsigned long swap_total;
+    unsigned long swap_free;
+    unsigned long huge_total;
+    unsigned long huge_free;
+    unsigned long huge_size;
+    unsigned long anon_huge;
+};
+
+// fill info with a single pass over /proc/meminfo, 0 on success
+static int read_meminfo(struct MemInfo *info) {
+    char buf[4096];
+    long len = keyval_read("/proc/meminfo", buf, sizeof(buf));
+    if(len <= 0)
+        return 1;
+
+    struct Field {
+        const char *key;
+        unsigned long *dest;
+    };
+    const struct Field fields[] = {
+        {"MemTotal:", &info->total},
+        {"MemFree:", &info->free},
+        {"MemAvailable:", &info->available},
+        {"Buffers:", &info->buffers},
+        {"Cached:", &info->cached},
+        {"Shmem:", &info->shmem},
+        {"SReclaimable:", &info->reclaimable},
+        {"SwapTotal:", &info->swap_total},
+        {"SwapFree:", &info->swap_free},
+        {"HugePages_Total:", &info->huge_total},
+        {"HugePages_Free:", &info->huge_free},
+        {"Hugepagesize:", &info->huge_size},
+        {"AnonHugePages:", &info->anon_huge},
+    };
+    const size_t field_num = sizeof(fields)/sizeof(fields[0]);
+
+    struct KeyVal keys[field_num];
+    for(size_t i = 0; i < field_num; ++i)
+        keys[i].key = fields[i].key;
+
+    keyval_find(buf, (size_t)len, keys, field_num);
+
+    for(size_t i = 0; i < field_num; ++i)
+        *fields[i].dest = keys[i].value ? strtoul(keys[i].value, NULL, 10) : 0;
+
+    if(info->total == 0)
+        return 1;
+
+    // kernels older than 3.14 don't have it
+    if(keys[2].value == NULL)
+        info->available = info->free + info->buffers + info->cached;
+
+    return 0;
+}
 #endif // __APPLE__
 
 // get used and total memory
-int memory(char *dest) {
+int memory(char *dest, struct Context *ctx) {
+    (void)ctx;
+
     #ifdef __APPLE__ 
         bytes_t usedram = used_mem_size();
         bytes_t totalram = system_mem_size();
@@ -24,50 +90,49 @@ int memory(char *dest) {
         }
 
         snprintf(dest, 256, "%llu MiB / %llu MiB", usedram/1048576, totalram/1048576);
+
+        if(mem_perc) {
+            const size_t len = 256-strlen(dest);
+            char perc[len];
+
+            snprintf(perc, len, " (%lu%%)", (unsigned long)((usedram * 100) / totalram));
+            strcat(dest, perc);
+        }
     #else
-        struct sysinfo info;
-        if(sysinfo(&info))
+        struct MemInfo info;
+        if(read_meminfo(&info))
             return 1;
 
-        unsigned long totalram = info.totalram / 1024;
-        unsigned long freeram = info.freeram / 1024;
-        // unsigned long sharedram = info.sharedram / 1024;
-
-        FILE *fp = fopen("/proc/meminfo", "r");
+        // what can't be given back to the system: caches, buffers and reclaimable slabs are, shared memory is not
+        const unsigned long reclaimed = info.buffers + info.cached + info.reclaimable;
+        unsigned long usedram = info.total - info.free;
+        usedram = usedram > reclaimed ? usedram - reclaimed : 0;
+        usedram += info.shmem;
 
-        if(fp == NULL)
-            return 1;
+        snprintf(dest, 256, "%lu MiB / %lu MiB", usedram/1024, info.total/1024);
 
-        char buf[256];
-        char *cachedram = buf;
+        size_t used = strlen(dest);
 
-        read_after_sequence(fp, "Cached:", buf, 256);
-        fclose(fp);
+        // with mem_avail_perc, how much can't be allocated without swapping (rather than how much is in use)
+        if(mem_perc) {
+            const unsigned long perc = mem_avail_perc && info.available <= info.total
+                                       ? (info.total - info.available) * 100 / info.total
+                                       : usedram * 100 / info.total;
 
-        if(buf[0] == 0)
-            return 1;
-        cachedram += 2;
+            used += (size_t)snprintf(dest+used, 256-used, " (%lu%%)", perc);
+        }
 
-        char *end = strstr(cachedram, " kB");
-        
-        if(end == NULL)
-            return 1;
-        
-        *end = 0;
+        if(mem_swap && info.swap_total && used < 256)
+            used += (size_t)snprintf(dest+used, 256-used, ", Swap: %lu MiB / %lu MiB",
+                                     (info.swap_total - info.swap_free)/1024, info.swap_total/1024);
 
-        unsigned long usedram = totalram - freeram - atol(cachedram);
-        // usedram -= sharedram;
+        if(mem_hugepages && info.huge_total && used < 256)
+            used += (size_t)snprintf(dest+used, 256-used, ", HugePages: %lu / %lu (%lu MiB)",
+                                     info.huge_total - info.huge_free, info.huge_total, info.huge_total * info.huge_size / 1024);
 
-        snprintf(dest, 256, "%lu MiB / %lu MiB", usedram/1024, totalram/1024);
+        if(mem_hugepages && info.anon_huge && used < 256)
+            snprintf(dest+used, 256-used, ", THP: %lu MiB", info.anon_huge/1024);
     #endif
 
-    if(mem_perc) {
-        const size_t len = 256-strlen(dest);
-        char perc[len];
-        
-        snprintf(perc, len, " (%lu%%)", (unsigned long)((usedram * 100) / totalram));
-        strcat(dest, perc);
-    }
-
     return 0;
 }
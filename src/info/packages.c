@@ -1,158 +1,815 @@
 #include "info.h"
+#include "../dir.h"
+#include "../proc.h"
+#include "../sqlite.h"
 #include "../utils.h"
 
 #include <string.h>
 
+#include <ctype.h>
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
-#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-// get the number of installed packages
-int packages(char *dest) {
-    dest[0] = 0;
-    char buf[256] = "", str[128] = "", path[256] = "";
-    DIR *dir;
-    struct dirent *entry;
+// map the file at path to memory, NULL if it's missing or empty
+static const char *map_file(const char *path, size_t *len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return NULL;
+
+    struct stat st;
+    if(fstat(fd, &st) || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    *len = (size_t)st.st_size;
+    const char *map = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(map == MAP_FAILED)
+        return NULL;
+
+    madvise((void *)map, *len, MADV_SEQUENTIAL);
+
+    return map;
+}
+
+// count how many times needle appears in map
+static unsigned count_in(const char *map, const size_t len, const char *needle) {
+    const size_t needle_len = strlen(needle);
+    const char *ptr = map, *end = map + len;
     unsigned count = 0;
-    bool done = false;
 
-    #ifndef __APPLE__   // package managers that won't run on macOS
-        FILE *fp;
-
-        path[0] = 0;
-        if(getenv("PREFIX"))
-            strncpy(path, getenv("PREFIX"), 255);
-        strncat(path, "/var/lib/pacman/local", 256-strlen(path));
-        if(pkg_pacman && (dir = opendir(path))) {
-            while((entry = readdir(dir)) != NULL)
-                if(entry->d_type == DT_DIR && strcmp(entry->d_name, ".") && strcmp(entry->d_name, ".."))
-                    ++count;
-
-            if(count) {
-                snprintf(dest, 255 - strlen(buf), "%s%u%s", done ? ", " : "", count, pkg_mgr ? " (pacman)" : "");
-                done = true;
-            }
-            closedir(dir);
+    while((ptr = memmem(ptr, (size_t)(end - ptr), needle, needle_len))) {
+        ptr += needle_len;
+        ++count;
+    }
+
+    return count;
+}
+
+// count how many times needle appears in the file at path
+static unsigned count_matches(const char *path, const char *needle) {
+    size_t len;
+    const char *map = map_file(path, &len);
+    if(map == NULL)
+        return 0;
+
+    const unsigned count = count_in(map, len, needle);
+    munmap((void *)map, len);
+
+    return count;
+}
+
+#ifndef __APPLE__
+// count the directories in a listing
+static void count_dirs(const char *name, const unsigned char type, void *arg) {
+    (void)name;
+
+    if(type == DT_DIR)
+        ++*(unsigned *)arg;
+}
+
+// count the packages in the pacman database, every one has its own directory
+static unsigned pacman_count(const char *prefix, const char *home) {
+    (void)home;
+
+    char path[PATH_MAX];
+    unsigned count = 0;
+
+    snprintf(path, sizeof(path), "%s/var/lib/pacman/local", prefix);
+    dir_list(path, count_dirs, &count);
+
+    return count;
+}
+
+/* count the installed packages in the dpkg status file
+ * (the stanzas with "Status: <want> ok installed")
+ * the file is mapped instead of being read, and memmem() skips from one Status field to the next
+ */
+static unsigned dpkg_count(const char *prefix, const char *home) {
+    (void)home;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/var/lib/dpkg/status", prefix);
+
+    size_t len;
+    const char *map = map_file(path, &len);
+    if(map == NULL)
+        return 0;
+
+    const char field[] = "\nStatus: ";
+    const char installed[] = " installed";
+    const size_t field_len = sizeof(field)-1;
+    const size_t installed_len = sizeof(installed)-1;
+
+    const char *ptr = map, *end = map + len;
+    unsigned count = 0;
+
+    while((ptr = memmem(ptr, (size_t)(end - ptr), field, field_len))) {
+        ptr += field_len;
+
+        const char *eol = memchr(ptr, '\n', (size_t)(end - ptr));
+        if(eol == NULL)
+            eol = end;
+
+        if((size_t)(eol - ptr) >= installed_len && memcmp(eol - installed_len, installed, installed_len) == 0)
+            ++count;
+
+        ptr = eol;
+    }
+
+    munmap((void *)map, len);
+
+    return count;
+}
+
+// count the packages in the rpm database, with the sqlite3 CLI if it can't be read directly
+static unsigned rpm_count(const char *prefix, const char *home) {
+    (void)home;
+
+    char path[PATH_MAX];
+    unsigned long count = 0;
+
+    snprintf(path, sizeof(path), "%s/var/lib/rpm/rpmdb.sqlite", prefix);
+    if(sqlite_count_rows(path, "Packages", &count) == 0)
+        return (unsigned)count;
+
+    if(access(path, F_OK))
+        return 0;
+
+    char output[32];
+    char *args[] = {"sqlite3", path, "SELECT count(*) FROM Packages", NULL};
+    struct Proc proc = {.argv = args, .buf = output, .len = sizeof(output), .timeout = config.pkg_timeout};
+
+    if(proc_start(&proc) == 0)
+        proc_collect(&proc, 1);
+
+    return proc.status == 0 ? (unsigned)strtoul(output, NULL, 10) : 0;
+}
+
+// count the packages in the apk database, every one of them has a "P:<name>" line
+static unsigned apk_count(const char *prefix, const char *home) {
+    (void)home;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/lib/apk/db/installed", prefix);
+
+    size_t len;
+    const char *map = map_file(path, &len);
+    if(map == NULL)
+        return 0;
+
+    // the first package starts right at the beginning of the file, without a newline
+    const unsigned count = (len >= 2 && memcmp(map, "P:", 2) == 0) + count_in(map, len, "\nP:");
+
+    munmap((void *)map, len);
+
+    return count;
+}
+
+// find the xbps package database ("pkgdb-<version>.plist")
+static void find_pkgdb(const char *name, const unsigned char type, void *arg) {
+    (void)type;
+
+    char *dest = arg;
+    const size_t len = strlen(name);
+
+    if(strncmp(name, "pkgdb-", 6) == 0 && len > 12 && len < 64 && strcmp(name + len - 6, ".plist") == 0)
+        strcpy(dest, name);
+}
+
+// count the packages in the xbps database, a plist with one "pkgver" key per package
+static unsigned xbps_count(const char *prefix, const char *home) {
+    (void)home;
+
+    char path[PATH_MAX], name[64] = "";
+
+    snprintf(path, sizeof(path), "%s/var/db/xbps", prefix);
+    if(dir_list(path, find_pkgdb, name) <= 0 || name[0] == 0)
+        return 0;
+
+    strncat(path, "/", sizeof(path) - strlen(path) - 1);
+    strncat(path, name, sizeof(path) - strlen(path) - 1);
+
+    return count_matches(path, "<key>pkgver</key>");
+}
+
+// where portage_walk() is in the CATEGORY/PACKAGE-VERSION tree
+struct PortageWalk {
+    char path[PATH_MAX];
+    bool in_category;
+    unsigned count;
+    struct DirBuf dirs;
+};
+
+static void portage_walk(const char *name, const unsigned char type, void *arg) {
+    struct PortageWalk *walk = arg;
+
+    // hidden entries and packages that are being merged ("-MERGING-*") are not installed
+    if((type != DT_DIR && type != DT_UNKNOWN) || name[0] == '.' || name[0] == '-')
+        return;
+
+    if(walk->in_category) {
+        ++walk->count;
+        return;
+    }
+
+    const size_t len = strlen(walk->path);
+    if(snprintf(walk->path + len, sizeof(walk->path) - len, "/%s", name) < (int)(sizeof(walk->path) - len)) {
+        walk->in_category = true;
+        dir_list_buf(&walk->dirs, walk->path, portage_walk, walk);
+        walk->in_category = false;
+    }
+
+    walk->path[len] = 0;
+}
+
+// count the packages installed by portage, every one has its own directory in /var/db/pkg/CATEGORY
+static unsigned portage_count(const char *prefix, const char *home) {
+    (void)home;
+
+    struct PortageWalk walk;
+
+    walk.in_category = false;
+    walk.count = 0;
+    snprintf(walk.path, sizeof(walk.path), "%s/var/db/pkg", prefix);
+    dir_buf_init(&walk.dirs);
+    dir_list_buf(&walk.dirs, walk.path, portage_walk, &walk);
+    dir_buf_free(&walk.dirs);
+
+    return walk.count;
+}
+#endif // __APPLE__
+
+/* count the packages in a nix profile, from its manifest:
+ * "nix profile" writes manifest.json, with a "storePaths" list for every element,
+ * while "nix-env" writes manifest.nix, a list of derivations
+ */
+static unsigned nix_profile_count(const char *profile) {
+    char path[PATH_MAX + 16];
+    unsigned count;
+
+    snprintf(path, sizeof(path), "%s/manifest.json", profile);
+    if((count = count_matches(path, "\"storePaths\"")))
+        return count;
+
+    snprintf(path, sizeof(path), "%s/manifest.nix", profile);
+    return count_matches(path, "type = \"derivation\";");
+}
+
+// count the packages in the default nix profile and the one of the user
+static unsigned nix_count(const char *prefix, const char *home) {
+    char path[PATH_MAX];
+    unsigned count;
+
+    snprintf(path, sizeof(path), "%s/nix/var/nix/profiles/default", prefix);
+    count = nix_profile_count(path);
+
+    if(home) {
+        snprintf(path, sizeof(path), "%s/.nix-profile", home);
+        count += nix_profile_count(path);
+    }
+
+    return count;
+}
+
+// a growing list of package names, which may have duplicates
+struct Names {
+    char (*names)[64];
+    size_t count;
+    size_t size;
+};
+
+// make room for one more name, NULL if there is no memory left
+static char *new_name(struct Names *list) {
+    if(list->count == list->size) {
+        size_t size = list->size ? list->size*2 : 64;
+        char (*names)[64] = realloc(list->names, size * sizeof(*names));
+        if(names == NULL)
+            return NULL;
+
+        list->names = names;
+        list->size = size;
+    }
+
+    return list->names[list->count++];
+}
+
+// save the name of a "name-version.dist-info" or "name-version.egg-info" entry
+static void add_pip_name(const char *name, const unsigned char type, void *arg) {
+    (void)type;
+
+    const char *suffixes[] = {".dist-info", ".egg-info"};
+    const size_t len = strlen(name);
+    size_t name_len = 0;
+
+    for(size_t i = 0; i < sizeof(suffixes)/sizeof(suffixes[0]); ++i) {
+        const size_t suffix_len = strlen(suffixes[i]);
+
+        if(len > suffix_len && strcmp(name + len - suffix_len, suffixes[i]) == 0)
+            name_len = len - suffix_len;
+    }
+    if(name_len == 0)
+        return;
+
+    // the version (if any) starts at the first '-'
+    const char *dash = memchr(name, '-', name_len);
+    if(dash)
+        name_len = (size_t)(dash - name);
+
+    char *normalized = new_name(arg);
+    if(normalized == NULL)
+        return;
+
+    // normalized like pip does: lowercase, with every run of "-_." turned into a single '-'
+    size_t used = 0;
+    for(size_t i = 0; i < name_len && used < 63; ++i) {
+        if(strchr("-_.", name[i])) {
+            if(used == 0 || normalized[used-1] != '-')
+                normalized[used++] = '-';
         }
+        else
+            normalized[used++] = tolower((unsigned char)name[i]);
+    }
+    normalized[used] = 0;
+}
 
-        path[0] = 0;
-        if(getenv("PREFIX"))
-            strncpy(path, getenv("PREFIX"), 255);
-        strncat(path, "/var/lib/dpkg/status", 256-strlen(path));
-        if(pkg_dpkg && (fp = fopen(path, "r"))) {   // alternatively, I could use "dpkg-query -f L -W" and strlen
-            fseek(fp, 0, SEEK_END);
-            size_t len = (size_t)ftell(fp);
-            rewind(fp);
+static int compare_names(const void *a, const void *b) {
+    return strcmp(a, b);
+}
 
-            char *dpkg_list = malloc(len);
-            dpkg_list[fread(dpkg_list, 1, len, fp) - 1] = 0;
+// count the different names in list, and free it
+static unsigned count_unique(struct Names *list) {
+    unsigned count = 0;
 
-            fclose(fp);
+    if(list->count) {
+        qsort(list->names, list->count, sizeof(list->names[0]), compare_names);
 
-            count = 0;
-            // this will be wrong if some package does not have "\nInstalled-Size: "
-            // or if some package (for some reason) has it in the package description
-            while((dpkg_list = strstr(dpkg_list, "\nInstalled-Size: "))) {
+        for(size_t i = 0; i < list->count; ++i)
+            if(i == 0 || strcmp(list->names[i], list->names[i-1]))
                 ++count;
-                ++dpkg_list;
-            }
-            free(dpkg_list);
-
-            if(count) {
-                snprintf(buf, 256, "%u%s", count, pkg_mgr ? " (dpkg)" : "");
-                done = true;
-                strncat(dest, buf, 256 - strlen(dest));
-            }
-        }
+    }
 
-        path[0] = 0;
-        if(getenv("PREFIX"))
-            strncpy(path, getenv("PREFIX"), 255);
-        strncat(path, "/var/lib/rpm/rpmdb.sqlite", 256-strlen(path));
-        if(pkg_rpm && access(path, F_OK) == 0) {
-            char *args[] = {"sqlite3", path, "SELECT count(*) FROM Packages", NULL};
-            exec_cmd(str, 16, args);
-
-            if(str[0] != '0' && str[0]) {
-                snprintf(buf, 255 - strlen(buf), "%s%s%s", done ? ", " : "", str, pkg_mgr ? " (rpm)" : "");
-                done = true;
-                strncat(dest, buf, 256 - strlen(dest));
-            }
-        }
+    free(list->names);
+
+    return count;
+}
 
-        path[0] = 0;
-        if(getenv("PREFIX"))
-            strncpy(path, getenv("PREFIX"), 255);
-        strncat(path, "/var/lib/flatpak/runtime", 256-strlen(path));
-        if(pkg_flatpak && (dir = opendir(path))) {
-            count = 0;
-            while((entry = readdir(dir)) != NULL)
-                if(entry->d_type == DT_DIR && strcmp(entry->d_name, ".") && strcmp(entry->d_name, ".."))
-                    ++count;
-
-            if(count) {
-                snprintf(buf, 255 - strlen(buf), "%s%u%s", done ? ", " : "", count, pkg_mgr ? " (flatpak)" : "");
-                done = true;
-                strncat(dest, buf, 256 - strlen(dest));
-            }
-            closedir(dir);
+// keep the highest "python3.N" directory name
+static void find_python(const char *name, const unsigned char type, void *arg) {
+    (void)type;
+
+    char *best = arg;
+
+    if(strncmp(name, "python3.", 8) || isdigit((unsigned char)name[8]) == 0 || strlen(name) >= 16)
+        return;
+
+    if(best[0] == 0 || atoi(name+8) > atoi(best+8))
+        strcpy(best, name);
+}
+
+/* get the name of the python pip runs with (e.g. "python3.11"),
+ * from the shebang of the pip script or, failing that, the newest one installed
+ */
+static void pip_python(const char *prefix, char *dest) {
+    char path[PATH_MAX], line[256] = "";
+
+    dest[0] = 0;
+
+    snprintf(path, sizeof(path), "%s/bin/pip", prefix);
+    FILE *fp = fopen(path, "r");
+    if(fp) {
+        if(fgets(line, sizeof(line), fp) == NULL)
+            line[0] = 0;
+        fclose(fp);
+    }
+
+    if(strncmp(line, "#!", 2) == 0) {
+        char *interpreter = line+2;
+        interpreter[strcspn(interpreter, " \t\n")] = 0;
+
+        // the interpreter is usually a link to the versioned one
+        char real[PATH_MAX];
+        if(realpath(interpreter, real)) {
+            const char *name = strrchr(real, '/');
+            find_python(name ? name+1 : real, DT_UNKNOWN, dest);
         }
+    }
+
+    if(dest[0] == 0) {
+        snprintf(path, sizeof(path), "%s/usr/lib", prefix);
+        dir_list(path, find_python, dest);
+        snprintf(path, sizeof(path), "%s/lib", prefix);
+        dir_list(path, find_python, dest);
+    }
+}
+
+/* count the python distributions installed for pip, without running it:
+ * pip lists every *.dist-info and *.egg-info in the site-packages
+ * (or dist-packages on Debian) directories of its interpreter
+ */
+static unsigned pip_count(const char *prefix, const char *home) {
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s/bin/pip", prefix);
+    if(access(path, F_OK))
+        return 0;
+
+    char python[16];
+    pip_python(prefix, python);
+    if(python[0] == 0)
+        return 0;
+
+    const char *system_dirs[] = {
+        "%s/usr/lib/python3/dist-packages",
+        "%s/usr/lib/%s/site-packages",
+        "%s/usr/lib/%s/dist-packages",
+        "%s/usr/lib64/%s/site-packages",
+        "%s/usr/local/lib/%s/site-packages",
+        "%s/usr/local/lib/%s/dist-packages",
+        "%s/lib/%s/site-packages",
+    };
+    const size_t dir_num = sizeof(system_dirs)/sizeof(system_dirs[0]);
+
+    // the same directory may be reached through a symlink (e.g. /lib -> /usr/lib)
+    struct stat seen[dir_num + 1];
+    size_t seen_num = 0;
+
+    struct Names list = {NULL, 0, 0};
+
+    for(size_t i = 0; i <= dir_num; ++i) {
+        if(i < dir_num)
+            snprintf(path, sizeof(path), system_dirs[i], prefix, python);
+        else if(home)
+            snprintf(path, sizeof(path), "%s/.local/lib/%s/site-packages", home, python);
+        else
+            break;
+
+        struct stat st;
+        if(stat(path, &st))
+            continue;
+
+        bool duplicate = false;
+        for(size_t j = 0; j < seen_num; ++j)
+            if(seen[j].st_dev == st.st_dev && seen[j].st_ino == st.st_ino)
+                duplicate = true;
+        if(duplicate)
+            continue;
+        seen[seen_num++] = st;
+
+        dir_list(path, add_pip_name, &list);
+    }
+
+    // the same distribution may be found in more than one directory (only the first one counts)
+    return count_unique(&list);
+}
+
+#ifndef __APPLE__
+// save the name of a "name_revision.snap" file (every revision that is kept around has one)
+static void add_snap_name(const char *name, const unsigned char type, void *arg) {
+    if(type != DT_REG && type != DT_UNKNOWN)
+        return;
 
-        path[0] = 0;
-        if(getenv("PREFIX"))
-            strncpy(path, getenv("PREFIX"), 255);
-        strncat(path, "/bin/snap", 256-strlen(path));
-        if(pkg_snap && access(path, F_OK) == 0) {
-            char *args[] = {"sh", "-c", "snap list 2>/dev/null | wc -l", NULL};
-            exec_cmd(str, 16, args);
-
-            if(str[0] != '0' && str[0]) {
-                snprintf(buf, 255 - strlen(buf), "%s%d%s", done ? ", " : "", atoi(str)-1, pkg_mgr ? " (snap)" : "");
-                done = true;
-                strncat(dest, buf, 256 - strlen(dest));
-            }
+    const size_t len = strlen(name);
+    if(len <= 5 || strcmp(name + len - 5, ".snap"))
+        return;
+
+    const char *underscore = strrchr(name, '_');
+    if(underscore == NULL || underscore == name || (size_t)(underscore - name) >= 64)
+        return;
+
+    char *dest = new_name(arg);
+    if(dest == NULL)
+        return;
+
+    memcpy(dest, name, (size_t)(underscore - name));
+    dest[underscore - name] = 0;
+}
+
+// save the name of a snap mounted in /snap ("bin" only holds the commands)
+static void add_snap_mount(const char *name, const unsigned char type, void *arg) {
+    if((type != DT_DIR && type != DT_UNKNOWN) || strcmp(name, "bin") == 0 || strlen(name) >= 64)
+        return;
+
+    char *dest = new_name(arg);
+    if(dest)
+        strcpy(dest, name);
+}
+
+// count the installed snaps, like "snap list" would
+static unsigned snap_count(const char *prefix, const char *home) {
+    (void)home;
+
+    struct Names list = {NULL, 0, 0};
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s/var/lib/snapd/snaps", prefix);
+    if(dir_list(path, add_snap_name, &list) < 0) {
+        snprintf(path, sizeof(path), "%s/snap", prefix);
+        dir_list(path, add_snap_mount, &list);
+    }
+
+    return count_unique(&list);
+}
+
+// where flatpak_walk() is in a {app,runtime}/NAME/ARCH/BRANCH tree
+struct FlatpakWalk {
+    char path[PATH_MAX];
+    int depth;
+    unsigned count;
+    struct DirBuf dirs;
+};
+
+static void flatpak_walk(const char *name, const unsigned char type, void *arg) {
+    struct FlatpakWalk *walk = arg;
+
+    if(type != DT_DIR && type != DT_UNKNOWN)
+        return;
+
+    const size_t len = strlen(walk->path);
+    if(snprintf(walk->path + len, sizeof(walk->path) - len, "/%s", name) >= (int)(sizeof(walk->path) - len)) {
+        walk->path[len] = 0;
+        return;
+    }
+
+    if(walk->depth == 2) {
+        // a branch is installed once it has an active deployment
+        strncat(walk->path, "/active", sizeof(walk->path) - strlen(walk->path) - 1);
+        if(access(walk->path, F_OK) == 0)
+            ++walk->count;
+    }
+    else {
+        ++walk->depth;
+        dir_list_buf(&walk->dirs, walk->path, flatpak_walk, walk);
+        --walk->depth;
+    }
+
+    walk->path[len] = 0;
+}
+
+/* count the installed flatpak apps and runtimes, like "flatpak list" would:
+ * one for every branch of every arch, both system wide and for the current user
+ */
+static unsigned flatpak_count(const char *prefix, const char *home) {
+    const char *kinds[] = {"app", "runtime"};
+    struct FlatpakWalk walk;
+
+    walk.count = 0;
+    dir_buf_init(&walk.dirs);
+    for(int i = 0; i < 2; ++i) {
+        if(i == 1 && home == NULL)
+            break;
+
+        for(size_t j = 0; j < sizeof(kinds)/sizeof(kinds[0]); ++j) {
+            if(i == 0)
+                snprintf(walk.path, sizeof(walk.path), "%s/var/lib/flatpak/%s", prefix, kinds[j]);
+            else
+                snprintf(walk.path, sizeof(walk.path), "%s/.local/share/flatpak/%s", home, kinds[j]);
+
+            walk.depth = 0;
+            dir_list_buf(&walk.dirs, walk.path, flatpak_walk, &walk);
         }
+    }
+    dir_buf_free(&walk.dirs);
+
+    return walk.count;
+}
+#endif // __APPLE__
+
+// count the formulae in the brew cellar, which "brew --cellar" tells where to find
+static unsigned brew_count(const char *prefix, const char *home) {
+    (void)prefix;
+    (void)home;
+
+    if(access("/usr/local/bin/brew", F_OK) && access("/opt/homebrew/bin/brew", F_OK) && access("/bin/brew", F_OK))
+        return 0;
+
+    char cellar[PATH_MAX];
+    char *args[] = {"brew", "--cellar", NULL};
+    struct Proc proc = {.argv = args, .buf = cellar, .len = sizeof(cellar), .timeout = config.pkg_timeout};
+
+    if(proc_start(&proc) == 0)
+        proc_collect(&proc, 1);
+
+    unsigned count = 0;
+    if(proc.status == 0 && cellar[0])
+        dir_list(cellar, count_dirs, &count);
+
+    return count;
+}
+
+// a package manager, in the order they are printed
+struct Manager {
+    const char *name;
+    unsigned (*count)(const char *prefix, const char *home);
+};
+
+static const struct Manager managers[] = {
+    #ifndef __APPLE__   // package managers that won't run on macOS
+        {"pacman", pacman_count},
+        {"dpkg", dpkg_count},
+        {"rpm", rpm_count},
+        {"apk", apk_count},
+        {"xbps", xbps_count},
+        {"portage", portage_count},
+        {"flatpak", flatpak_count},
+        {"snap", snap_count},
     #endif
-    if(pkg_brew && (access("/usr/local/bin/brew", F_OK) == 0 || access("/opt/homebrew/bin/brew", F_OK) == 0 || access("/bin/brew", F_OK) == 0)) {
-        char *args[] = {"brew", "--cellar", NULL};
-        exec_cmd(str, 16, args);
-
-        if(str[0]) {
-            if((dir = opendir(str))) {
-                count = 0;
-
-                while((entry = readdir(dir)) != NULL)
-                    if(entry->d_type == DT_DIR && strcmp(entry->d_name, ".") && strcmp(entry->d_name, ".."))
-                        ++count;
-
-                if(count) {
-                    snprintf(buf, 256, "%s%u%s", done ? ", " : "", count, pkg_mgr ? " (brew)" : "");
-                    done = true;
-                    strncat(dest, buf, 256 - strlen(dest));
-                }
-
-                closedir(dir);
-            }
-        }
+    {"brew", brew_count},
+    {"nix", nix_count},
+    {"pip", pip_count},
+};
+
+#define MANAGER_NUM (sizeof(managers)/sizeof(managers[0]))
+
+/* managers whose thread (from an earlier call, in the daemon) is still counting
+ * a new one is not started for them, so that stuck threads don't pile up
+ */
+static pthread_mutex_t busy_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool busy[MANAGER_NUM];
+
+/* what packages() shares with the threads counting for it
+ * a thread that is still stuck when packages() stops waiting keeps it alive,
+ * the last one to let go of it frees it
+ */
+struct Counting {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned refs;                  // packages() and every thread that's still running
+    unsigned pending;               // threads that haven't finished yet
+
+    char prefix[PATH_MAX];
+    char home[PATH_MAX];            // empty if $HOME is not set
+    unsigned counts[MANAGER_NUM];
+    bool finished[MANAGER_NUM];
+
+    struct CountJob {
+        struct Counting *counting;
+        size_t index;
+    } jobs[MANAGER_NUM];
+};
+
+// let go of counting
+static void release_counting(struct Counting *counting) {
+    pthread_mutex_lock(&counting->lock);
+    const bool last = --counting->refs == 0;
+    pthread_mutex_unlock(&counting->lock);
+
+    if(last) {
+        pthread_cond_destroy(&counting->cond);
+        pthread_mutex_destroy(&counting->lock);
+        free(counting);
     }
+}
 
+static void *count_thread(void *arg) {
+    struct CountJob *job = arg;
+    struct Counting *counting = job->counting;
 
-    path[0] = 0;
-    if(getenv("PREFIX"))
-        strncpy(path, getenv("PREFIX"), 255);
-    strncat(path, "/bin/pip", 256-strlen(path));
-    if(pkg_pip && access(path, F_OK) == 0) {
-        char *args[] = {"sh", "-c", "pip list 2>/dev/null | wc -l", NULL};
-        exec_cmd(str, 16, args);
-        
-        if(str[0] != '0' && str[0]) {
-            snprintf(buf, 255 - strlen(buf), "%s%d%s", done ? ", " : "", atoi(str)-2, pkg_mgr ? " (pip)" : "");
-            done = true;
-            strncat(dest, buf, 256 - strlen(dest));
+    const unsigned count = managers[job->index].count(counting->prefix, counting->home[0] ? counting->home : NULL);
+
+    pthread_mutex_lock(&counting->lock);
+    counting->counts[job->index] = count;
+    counting->finished[job->index] = true;
+    --counting->pending;
+    pthread_cond_signal(&counting->cond);
+    pthread_mutex_unlock(&counting->lock);
+
+    pthread_mutex_lock(&busy_lock);
+    busy[job->index] = false;
+    pthread_mutex_unlock(&busy_lock);
+
+    release_counting(counting);
+
+    return NULL;
+}
+
+// get the number of installed packages
+int packages(char *dest, struct Context *ctx) {
+    dest[0] = 0;
+
+    const bool enabled[] = {
+        #ifndef __APPLE__
+            pkg_pacman,
+            pkg_dpkg,
+            pkg_rpm,
+            pkg_apk,
+            pkg_xbps,
+            pkg_portage,
+            pkg_flatpak,
+            pkg_snap,
+        #endif
+        pkg_brew,
+        pkg_nix,
+        pkg_pip,
+    };
+
+    struct Counting *counting = calloc(1, sizeof(*counting));
+    if(counting == NULL)
+        return 1;
+
+    pthread_mutex_init(&counting->lock, NULL);
+    pthread_cond_init(&counting->cond, NULL);
+
+    // every path is relative to $PREFIX (if set)
+    const char *prefix = ctx_getenv(ctx, "PREFIX");
+    const char *home = ctx_getenv(ctx, "HOME");
+    strncpy(counting->prefix, prefix ? prefix : "", sizeof(counting->prefix)-1);
+    strncpy(counting->home, home ? home : "", sizeof(counting->home)-1);
+
+    // the ones that are still being counted since last time are skipped
+    bool started[MANAGER_NUM];
+
+    counting->refs = 1;
+    pthread_mutex_lock(&busy_lock);
+    for(size_t i = 0; i < MANAGER_NUM; ++i) {
+        started[i] = enabled[i] && busy[i] == false;
+
+        if(started[i]) {
+            busy[i] = true;
+            ++counting->refs;
+            ++counting->pending;
         }
     }
+    pthread_mutex_unlock(&busy_lock);
+
+    /* every package manager is counted in a thread of its own, so that this takes
+     * as long as the slowest one instead of all of them together
+     * the threads are detached: one that gets stuck is simply not waited for
+     */
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    for(size_t i = 0; i < MANAGER_NUM; ++i) {
+        if(started[i] == false)
+            continue;
+
+        struct CountJob *job = counting->jobs + i;
+        job->counting = counting;
+        job->index = i;
+
+        pthread_t thread;
+        if(pthread_create(&thread, &attr, count_thread, job))
+            count_thread(job);
+    }
+
+    pthread_attr_destroy(&attr);
+
+    // waiting for them, but no longer than pkg_timeout
+    const int timeout = config.pkg_timeout > 0 ? config.pkg_timeout : PROC_TIMEOUT;
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (timeout % 1000) * 1000000L;
+    if(deadline.tv_nsec >= 1000000000L) {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    unsigned counts[MANAGER_NUM];
+    bool partial = false;
+
+    pthread_mutex_lock(&counting->lock);
+    while(counting->pending && pthread_cond_timedwait(&counting->cond, &counting->lock, &deadline) != ETIMEDOUT);
+
+    // whatever is not done by now is left out, and the result is not worth caching
+    for(size_t i = 0; i < MANAGER_NUM; ++i) {
+        counts[i] = counting->finished[i] ? counting->counts[i] : 0;
+        partial = partial || (enabled[i] && counting->finished[i] == false);
+    }
+    pthread_mutex_unlock(&counting->lock);
+
+    release_counting(counting);
+
+    char buf[256];
+    bool done = false;
+
+    for(size_t i = 0; i < MANAGER_NUM; ++i) {
+        if(counts[i] == 0)
+            continue;
+
+        if(pkg_mgr)
+            snprintf(buf, sizeof(buf), "%s%u (%s)", done ? ", " : "", counts[i], managers[i].name);
+        else
+            snprintf(buf, sizeof(buf), "%s%u", done ? ", " : "", counts[i]);
+
+        done = true;
+        strncat(dest, buf, 255 - strlen(dest));
+    }
+
+    if(done == false)
+        return 1;
 
-    return !done;
+    return partial ? INFO_PARTIAL : 0;
 }
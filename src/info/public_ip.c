@@ -1,70 +1,300 @@
 #include "info.h"
+#include "../utils.h"
 
 #define _GNU_SOURCE
 
 #include <string.h>
 
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/socket.h>
 
-// get the current public ip
-int public_ip(char *dest) {
-    // https://stackoverflow.com/a/65362666 - thanks dbush
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif // MSG_NOSIGNAL
+
+// default time (in ms) the endpoints get to answer
+#define PUB_TIMEOUT 1500
+
+// every endpoint is asked at once, the first valid answer wins
+struct Race {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned refs;          // public_ip() and every thread that's still running
+    unsigned pending;       // endpoints that haven't answered (or failed) yet
+    bool found;
+    char ip[64];
+
+    long deadline;          // in ms, on the CLOCK_MONOTONIC scale
+
+    struct RaceJob {
+        struct Race *race;
+        char endpoint[64];
+    } jobs[PUB_ENDPOINTS];
+};
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+// let go of race
+static void release_race(struct Race *race) {
+    pthread_mutex_lock(&race->lock);
+    const bool last = --race->refs == 0;
+    pthread_mutex_unlock(&race->lock);
+
+    if(last) {
+        pthread_cond_destroy(&race->cond);
+        pthread_mutex_destroy(&race->lock);
+        free(race);
+    }
+}
+
+// wait until fd is ready for events, returns 0 if it is before the deadline and nobody else answered
+static int wait_fd(struct Race *race, const int fd, const short events) {
+    for(;;) {
+        pthread_mutex_lock(&race->lock);
+        const bool found = race->found;
+        pthread_mutex_unlock(&race->lock);
+
+        const long left = race->deadline - now_ms();
+        if(found || left <= 0)
+            return 1;
+
+        // woken up every now and then to check if another endpoint was faster
+        struct pollfd pfd = {fd, events, 0};
+        const int ret = poll(&pfd, 1, left < 100 ? (int)left : 100);
+
+        if(ret > 0)
+            return 0;
+        if(ret < 0 && errno != EINTR)
+            return 1;
+    }
+}
+
+// connect to one of addrs without blocking past the deadline, returns the socket or -1
+static int connect_to(struct Race *race, const struct addrinfo *addrs) {
+    for(const struct addrinfo *addr = addrs; addr; addr = addr->ai_next) {
+        int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if(fd < 0)
+            continue;
+
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        if(connect(fd, addr->ai_addr, addr->ai_addrlen) == 0)
+            return fd;
+
+        int error = errno;
+        socklen_t len = sizeof(error);
+
+        if(error == EINPROGRESS && wait_fd(race, fd, POLLOUT) == 0
+           && getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0)
+            return fd;
+
+        close(fd);
+    }
+
+    return -1;
+}
+
+/* check the answer of an endpoint (used bytes long), and copy the ip in its body to dest
+ * buf should look like this:
+ * """
+ * HTTP/1.1 200 OK
+ * [...]
+ *
+ * 123.123.123.123
+ * """
+ */
+static int parse_answer(char *buf, const size_t used, char *dest, const size_t len) {
+    // "HTTP/1.x 200" at least
+    if(used < 12 || strncmp(buf, "HTTP/1.", 7) || strncmp(buf+8, " 200", 4))
+        return 1;
+
+    char *body = strstr(buf, "\r\n\r\n");
+    if(body == NULL)
+        return 1;
+    body += 4;
+
+    body += strspn(body, " \t\r\n");
+    body[strcspn(body, " \t\r\n")] = 0;
+
+    // anything else (a captive portal, an error page...) is not an ip
+    unsigned char addr[16];
+    if(body[0] == 0 || strlen(body) >= len
+       || (inet_pton(AF_INET, body, addr) != 1 && inet_pton(AF_INET6, body, addr) != 1))
+        return 1;
+
+    strcpy(dest, body);
+
+    return 0;
+}
+
+// ask an endpoint ("host[:port][/path]") for the public ip, returns 0 and saves it to dest on success
+static int ask_endpoint(struct Race *race, const char *endpoint, char *dest, const size_t len) {
+    char host[64], port[8] = "80";
+    const char *path = strchr(endpoint, '/');
+    size_t host_len = path ? (size_t)(path - endpoint) : strlen(endpoint);
+
+    if(path == NULL)
+        path = "/";
+
+    const char *colon = memchr(endpoint, ':', host_len);
+    if(colon) {
+        const size_t port_len = host_len - (size_t)(colon - endpoint) - 1;
+        if(port_len == 0 || port_len >= sizeof(port))
+            return 1;
+
+        memcpy(port, colon+1, port_len);
+        port[port_len] = 0;
+        host_len = (size_t)(colon - endpoint);
+    }
 
+    if(host_len == 0 || host_len >= sizeof(host))
+        return 1;
+    memcpy(host, endpoint, host_len);
+    host[host_len] = 0;
+
+    // the only step that can't be bounded, the thread is left behind if the resolver hangs
     struct addrinfo hints = {0}, *addrs;
     hints.ai_family = AF_INET;
     hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = 0;
-    
-    // using this as it is faster than ident.me
-    if(getaddrinfo("whatismyip.akamai.com", "80", &hints, &addrs))
-        return 1;
 
-    int socket_fd = socket(addrs->ai_family, addrs->ai_socktype, addrs->ai_protocol);
-    if(socket_fd == -1)
-        goto error;
-        
-    if(connect(socket_fd, addrs->ai_addr, addrs->ai_addrlen) == -1)
-        goto error;
-
-    char cmd[] = "GET / HTTP/1.1\nHost: whatismyip.akamai.com\n\n";
-    if(send(socket_fd, cmd, strlen(cmd), 0) == -1)
-        goto error;
-
-    char buf[1024] = {0};
-    if(recv(socket_fd, buf, sizeof(buf), 0) == -1)
-        goto error;
-
-    close(socket_fd);
-
-    /* buf should now look like this:
-     * """
-     * HTTP/1.1 200 OK
-     * [...]
-     * [...]
-     * 
-     * 123.123.123.123
-     * """
-     */
-    char *start = buf, *end;
-    end = strchr(start, '\n');
-    if(strncmp(start, "HTTP/1.1 200 OK", end - start - 1))
-        goto error;
-
-
-    start = strstr(start, "\n\r\n");
-    if(start == NULL)
-        goto error;
-
-    start += 3;
-    
-    strncpy(dest, start, 256);
+    if(getaddrinfo(host, port, &hints, &addrs))
+        return 1;
 
+    const int fd = connect_to(race, addrs);
     freeaddrinfo(addrs);
-    return 0;
 
-    error:
-    freeaddrinfo(addrs);
-    return 1;
+    if(fd < 0)
+        return 1;
+
+    char request[256];
+    const int request_len = snprintf(request, sizeof(request),
+                                     "GET %s HTTP/1.0\r\nHost: %s\r\nUser-Agent: albafetch\r\nConnection: close\r\n\r\n",
+                                     path, host);
+    int ret = 1;
+
+    if(request_len <= 0 || (size_t)request_len >= sizeof(request)
+       || wait_fd(race, fd, POLLOUT) || send(fd, request, (size_t)request_len, MSG_NOSIGNAL) != request_len)
+        goto done;
+
+    // the answer is read until the server closes the connection (or the buffer is full)
+    char buf[1024];
+    size_t used = 0;
+
+    while(used < sizeof(buf)-1 && wait_fd(race, fd, POLLIN) == 0) {
+        const ssize_t got = recv(fd, buf+used, sizeof(buf)-1-used, 0);
+
+        if(got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            continue;
+        if(got <= 0)
+            break;
+
+        used += (size_t)got;
+    }
+    buf[used] = 0;
+
+    ret = parse_answer(buf, used, dest, len);
+
+    done:
+    close(fd);
+
+    return ret;
+}
+
+static void *race_thread(void *arg) {
+    struct RaceJob *job = arg;
+    struct Race *race = job->race;
+    char ip[64];
+
+    const int ret = ask_endpoint(race, job->endpoint, ip, sizeof(ip));
+
+    pthread_mutex_lock(&race->lock);
+    if(ret == 0 && race->found == false) {
+        strcpy(race->ip, ip);
+        race->found = true;
+    }
+    --race->pending;
+    pthread_cond_signal(&race->cond);
+    pthread_mutex_unlock(&race->lock);
+
+    release_race(race);
+
+    return NULL;
+}
+
+// get the current public ip
+int public_ip(char *dest, struct Context *ctx) {
+    (void)ctx;
+
+    struct Race *race = calloc(1, sizeof(*race));
+    if(race == NULL)
+        return 1;
+
+    pthread_mutex_init(&race->lock, NULL);
+    pthread_cond_init(&race->cond, NULL);
+
+    const int timeout = config.pub_timeout > 0 ? config.pub_timeout : PUB_TIMEOUT;
+    race->deadline = now_ms() + timeout;
+    race->refs = 1;
+
+    // the defaults are used if every slot is empty (the config wasn't loaded, or the list was)
+    static const char defaults[PUB_ENDPOINTS][64] = DEFAULT_PUB_ENDPOINTS;
+    bool configured = false;
+    for(size_t i = 0; i < PUB_ENDPOINTS; ++i)
+        configured = configured || config.pub_endpoints[i][0];
+
+    pthread_mutex_lock(&race->lock);
+    for(size_t i = 0; i < PUB_ENDPOINTS; ++i) {
+        const char *endpoint = configured ? config.pub_endpoints[i] : defaults[i];
+        if(endpoint[0] == 0)
+            continue;
+
+        struct RaceJob *job = race->jobs + i;
+        job->race = race;
+        strcpy(job->endpoint, endpoint);
+
+        pthread_t thread;
+        if(pthread_create(&thread, NULL, race_thread, job))
+            continue;
+        pthread_detach(thread);
+
+        ++race->refs;
+        ++race->pending;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (timeout % 1000) * 1000000L;
+    if(deadline.tv_nsec >= 1000000000L) {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    // until an endpoint answers, all of them fail, or time is up
+    while(race->found == false && race->pending
+          && pthread_cond_timedwait(&race->cond, &race->lock, &deadline) != ETIMEDOUT);
+
+    const bool found = race->found;
+    if(found)
+        strcpy(dest, race->ip);
+    pthread_mutex_unlock(&race->lock);
+
+    release_race(race);
+
+    return !found;
 }
@@ -3,20 +3,18 @@
 
 #include <string.h>
 
-#include <unistd.h>
-
 // get the current working directory
-int pwd(char *dest) {
+int pwd(char *dest, struct Context *ctx) {
     if((pwd_path) == 0) {
         char buf[256];
 
-        if(getcwd(buf, 256) == NULL)
+        if(ctx_getcwd(ctx, buf, 256))
             return 1;
 
         strncpy(dest, buf, 256);
     }
 
-    if(getcwd(dest, 256) == NULL)
+    if(ctx_getcwd(ctx, dest, 256))
         return 1;
 
     return 0;
@@ -12,11 +12,11 @@
 #endif // __APPLE__
 
 // get the parent process name (usually the shell)
-int shell(char *dest) {
+int shell(char *dest, struct Context *ctx) {
     #ifdef __linux__
         char path[32];
 
-        sprintf(path, "/proc/%d/cmdline", getppid());
+        sprintf(path, "/proc/%d/cmdline", (int)ctx_parent(ctx));
 
         FILE *fp = fopen(path, "r");
         if(fp) {
@@ -34,9 +34,14 @@ int shell(char *dest) {
         }
     #endif
 
-    char *shell = getenv("SHELL");
+    const char *shell = ctx_getenv(ctx, "SHELL");
     if(shell && shell[0]) {
-        strncpy(dest, shell_path ? shell : basename(shell), 256);
+        // basename() may modify its argument
+        char path[256];
+        strncpy(path, shell, 255);
+        path[255] = 0;
+
+        strncpy(dest, shell_path ? path : basename(path), 256);
         return 0;
     }
 
@@ -7,7 +7,7 @@
 #include <stdlib.h>
 
 // get the current terminal
-int term(char *dest) {
+int term(char *dest, struct Context *ctx) {
     // TODO: print terminal version (using env variables, parsing --version outputs, ...)
     const char *terminal = NULL;
 
@@ -24,13 +24,13 @@ int term(char *dest) {
     };
 
     for(size_t i = 0; i < sizeof(terminals)/sizeof(terminals[0]); ++i)
-        if(getenv(terminals[i][0]))
+        if(ctx_getenv(ctx, terminals[i][0]))
             terminal = terminals[i][1];
 
     if(terminal == NULL) {
-        terminal = getenv("TERM_PROGRAM");
+        terminal = ctx_getenv(ctx, "TERM_PROGRAM");
         if(terminal == NULL)
-            terminal = getenv("TERM");
+            terminal = ctx_getenv(ctx, "TERM");
         if(terminal == NULL)
             return 1;
         
@@ -38,7 +38,7 @@ int term(char *dest) {
             terminal = "Kitty";
     }
 
-    if(term_ssh && getenv("SSH_CONNECTION"))
+    if(term_ssh && ctx_getenv(ctx, "SSH_CONNECTION"))
         snprintf(dest, 256, "%s (SSH)", terminal);
     else
         strncpy(dest, terminal, 256);
@@ -6,13 +6,13 @@
 
 #ifdef __APPLE__
 #include "../bsdwrap.h"
-#else
-#include <sys/sysinfo.h>
 #endif // __APPLE__
 
 // print the current uptime
-int uptime(char *dest) {
+int uptime(char *dest, struct Context *ctx) {
     #ifdef __APPLE__
+        (void)ctx;
+
         struct timeval boottime;
         int error;
         long uptime;
@@ -26,11 +26,11 @@ int uptime(char *dest) {
 
         uptime = (long)difftime(current_seconds, boot_seconds);
     #else
-        struct sysinfo info;
-        if(sysinfo(&info))
+        const struct sysinfo *info = ctx_sysinfo(ctx);
+        if(info == NULL)
             return 1;
 
-        const long uptime = info.uptime;
+        const long uptime = info->uptime;
     #endif // __APPLE__
 
     long days = uptime/86400;
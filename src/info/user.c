@@ -2,23 +2,14 @@
 
 #include <string.h>
 
-#include <unistd.h>
-#include <pwd.h>
-
-
 // print the current user
-int user(char *dest) {
-    struct passwd *pw;
+int user(char *dest, struct Context *ctx) {
+    const struct User *user = ctx_user(ctx);
 
-    unsigned uid = geteuid();
-    if((int)uid == -1) {
-        // couldn't get UID
+    if(user == NULL || user->name[0] == 0)
         return 1;
-    }
-
-    pw = getpwuid(uid);
 
-    strncpy(dest, pw->pw_name, 255);
+    strcpy(dest, user->name);
 
     return 0;
 }
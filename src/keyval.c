@@ -0,0 +1,101 @@
+#include "keyval.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+long keyval_read(const char *path, char *buf, const size_t len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return -1;
+
+    // regular files are read in one go, files in /proc may need a few reads
+    size_t used = 0;
+    while(used + 1 < len) {
+        ssize_t got = read(fd, buf + used, len - 1 - used);
+
+        if(got < 0 && errno == EINTR)
+            continue;
+        if(got <= 0)
+            break;
+
+        used += (size_t)got;
+    }
+
+    close(fd);
+    buf[used] = 0;
+
+    return (long)used;
+}
+
+size_t keyval_find(const char *buf, const size_t len, struct KeyVal *keys, const size_t count) {
+    const char *line = buf;
+    const char *end = buf + len;
+    size_t found = 0;
+
+    size_t key_lens[count];
+    for(size_t i = 0; i < count; ++i) {
+        keys[i].value = NULL;
+        keys[i].len = 0;
+        key_lens[i] = strlen(keys[i].key);
+    }
+
+    // hop from one line to the next, only ever looking at their first bytes
+    while(line < end && found < count) {
+        const char *eol = memchr(line, '\n', (size_t)(end - line));
+        if(eol == NULL)
+            eol = end;
+
+        const size_t line_len = (size_t)(eol - line);
+
+        for(size_t i = 0; i < count; ++i) {
+            if(keys[i].value || key_lens[i] > line_len || keys[i].key[0] != line[0]
+               || memcmp(line, keys[i].key, key_lens[i]))
+                continue;
+
+            keys[i].value = line + key_lens[i];
+            keys[i].len = line_len - key_lens[i];
+            ++found;
+
+            break;
+        }
+
+        line = eol + 1;
+    }
+
+    return found;
+}
+
+size_t keyval_copy(char *dest, const size_t len, const struct KeyVal *key) {
+    const char *value = key->value;
+    size_t value_len = key->len;
+
+    if(len == 0)
+        return 0;
+
+    if(value == NULL) {
+        dest[0] = 0;
+        return 0;
+    }
+
+    // sometimes we have something like `ID="distro"`
+    if(value_len && (value[0] == '"' || value[0] == '\'')) {
+        const char quote = value[0];
+
+        ++value;
+        --value_len;
+
+        const char *close = memchr(value, quote, value_len);
+        if(close)
+            value_len = (size_t)(close - value);
+    }
+
+    if(value_len >= len)
+        value_len = len-1;
+
+    memcpy(dest, value, value_len);
+    dest[value_len] = 0;
+
+    return value_len;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#ifndef KEYVAL_H
+#define KEYVAL_H
+
+#define _GNU_SOURCE
+
+#include <stddef.h>
+
+/*
+ * Reading "KEY<separator>value" files, like /etc/os-release or /proc/meminfo.
+ * The whole file is read into a buffer owned by the caller, and values
+ * are returned as views into it (they are not NUL terminated).
+ */
+
+struct KeyVal {
+    const char *key;    // matched at the start of a line, separator included ("ID=", "Cached:")
+    const char *value;  // start of the value, NULL if key was not found
+    size_t len;         // length of the value, up to the end of the line
+};
+
+// read up to len-1 bytes of path into buf and NUL terminate it, returns the bytes read or -1
+long keyval_read(const char *path, char *buf, const size_t len);
+
+/*
+ * Look for every key in a single pass over buf, only the first occurrence counts.
+ * Returns how many of them were found.
+ */
+size_t keyval_find(const char *buf, const size_t len, struct KeyVal *keys, const size_t count);
+
+// copy a value to dest without the quotes around it (if any), returns the length copied
+size_t keyval_copy(char *dest, const size_t len, const struct KeyVal *key);
+
+#endif // KEYVAL_H
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <limits.h>
@@ -7,9 +8,13 @@
 #include <sys/ioctl.h>
 
 #include "info/info.h"
+#include "cache.h"
+#include "context.h"
+#include "daemon.h"
 #include "utils.h"
 #include "logos.h"
-#include "queue.h"
+#include "pool.h"
+#include "render.h"
 
 // idk hy but this is sometimes not defined
 #ifndef HOST_NAME_MAX
@@ -25,6 +30,9 @@
     #define LOGIN_NAME_MAX HOST_NAME_MAX
 #endif
 
+// maximum number of modules running at the same time
+#define MODULE_THREADS 8
+
 /* TODO:
  * print de, shell and terminal versions
  * Windows support? *BSD support?
@@ -32,7 +40,6 @@
  * start using gtk for theme and icons
  * display resolution
  * storage
- * fix sqlite usage in packages for rpm
  * steam installed packages (off by default)
  * cpu temp (off by default)
  */
@@ -40,8 +47,8 @@
 // This contains the default config values
 struct Config config = {
     // Default values for boolean options (least to most significant bit)
-    // 0111 0101 1111 1110 1111 1001 0110 ...
-    0x69f7fae,
+    // 0111 0101 1111 1110 1111 1001 0111 1111 10 ...
+    0x1fe9f7fae,
 
     NULL,   // logo
     "",     // color
@@ -50,8 +57,12 @@ struct Config config = {
     5,      // spacing
 
     0,                              // gpu_index
+    2000,                           // pkg_timeout
+    1500,                           // pub_timeout
+    1800,                           // pub_ttl
     "%02d/%02d/%d %02d:%02d:%02d",  // date_format
     "   ",                          // col_block_str
+    DEFAULT_PUB_ENDPOINTS,          // pub_endpoints
 
     "",         // separator_prefix
     "",         // spacing_prefix
@@ -72,6 +83,7 @@ struct Config config = {
     "Host",     // host_prefix
     "BIOS",     // bios_prefix
     "CPU",      // cpu_prefix
+    "ISA",      // isa_prefix
     "GPU",      // gpu_prefix
     "Memory",   // mem_prefix
     "Public IP",// pub_prefix
@@ -83,6 +95,404 @@ struct Config config = {
     "",         // light_colors_prefix
 };
 
+// a module to run, and the context of the run
+struct Job {
+    struct Module *module;
+    struct Context *ctx;
+};
+
+// run a module, saving its output in its own slot
+static void run_module(void *arg) {
+    struct Job *job = arg;
+
+    job->module->ret = job->module->func(job->module->data, job->ctx);
+}
+
+/* getting the terminal width
+ * I start by using stdout
+ * if it is not a terminal (e.g. if the user did albafetch | lolcat) I use stderr
+ * if stderr doesn't work either, I use stdin (albafetch 2>/dev/null | lolcat)
+ * now, let's assume the user is a complete moron and redirects everything. Then I just use an "infinite" width
+ */
+static unsigned short terminal_width(void) {
+    struct winsize win;
+    win.ws_col = 0;
+    if(ioctl(STDOUT_FILENO, TIOCGWINSZ, &win))
+        if(ioctl(STDERR_FILENO, TIOCGWINSZ, &win))
+            ioctl(STDIN_FILENO, TIOCGWINSZ, &win);
+    if(win.ws_col == 0)
+        win.ws_col = -1;
+
+    return win.ws_col;
+}
+
+// modules that change from one run to the next (re-ran by the daemon on every request)
+static const char *volatile_modules[] = {
+    "uptime",
+    "memory",
+    "date",
+    "battery",
+
+    // these depend on the environment, working directory or parent of the client
+    "user",
+    "desktop",
+    "gtk_theme",
+    "icon_theme",
+    "cursor_theme",
+    "shell",
+    "login_shell",
+    "term",
+    "pwd",
+};
+
+static bool is_volatile(const char *id) {
+    for(size_t i = 0; i < sizeof(volatile_modules)/sizeof(volatile_modules[0]); ++i)
+        if(strcmp(volatile_modules[i], id) == 0)
+            return true;
+
+    return false;
+}
+
+/* whether an output made at made can still be used at now
+ * even on the same network the public ip can change, so it's only trusted for pub_ttl seconds
+ */
+static bool still_valid(const char *id, const time_t made, const time_t now) {
+    if(config.pub_ttl <= 0 || strcmp(id, "public_ip"))
+        return true;
+
+    return made <= now && now - made < config.pub_ttl;
+}
+
+/* run every module before printing anything
+ * they don't depend on each other, so the slowest one (and not the sum
+ * of all of them) determines how long this takes when parallel is set.
+ * Every module writes to its own slot, which is then printed in order.
+ * Modules with a still valid cached output don't need to run at all.
+ * When refreshing, only volatile modules and those whose fingerprint changed run again.
+ * With remember set, fingerprints are computed even if the cache is off,
+ * so that later refreshes can tell what changed.
+ */
+static void run_modules(struct Module *modules, const bool refresh, const bool remember, struct Context *ctx) {
+    size_t module_count = 0;
+    for(struct Module *current = modules->next; current; current = current->next)
+        if(current->func)
+            ++module_count;
+
+    if(module_count == 0)
+        return;
+
+    struct Job jobs[module_count];
+    void *job_ptrs[module_count];
+    char keys[module_count][320];   // fingerprint of every module, empty if it has none
+    char fingerprint[256];
+    bool ran[module_count];         // whether the module ran this time, instead of keeping an older output
+    const time_t now = time(NULL);
+    size_t job_count = 0, i = 0;
+
+    for(struct Module *current = modules->next; current; current = current->next) {
+        if(current->func == NULL)
+            continue;
+
+        keys[i][0] = 0;
+        ran[i] = false;
+
+        if((cache || remember) && current->fingerprint && current->fingerprint(fingerprint) == 0) {
+            // the output also depends on the options
+            snprintf(keys[i], sizeof(keys[i]), "%llx.%d.%s", (unsigned long long)config.options, config.gpu_index, fingerprint);
+
+            // still the same as in the last frame
+            if(refresh && current->ret == 0 && strcmp(current->key, keys[i]) == 0
+               && still_valid(current->id, current->made, now)) {
+                ++i;
+                continue;
+            }
+
+            time_t made;
+            if(cache && cache_get(current->id, keys[i], current->data, &made) == 0
+               && still_valid(current->id, made, now)) {
+                current->ret = 0;
+                strcpy(current->key, keys[i]);
+                current->made = made;
+                ++i;
+                continue;
+            }
+        }
+        else if(refresh && is_volatile(current->id) == false) {   // nothing tells whether it changed
+            ++i;
+            continue;
+        }
+
+        current->key[0] = 0;
+        ran[i] = true;
+        jobs[job_count] = (struct Job){current, ctx};
+        job_ptrs[job_count] = jobs + job_count;
+        ++job_count;
+        ++i;
+    }
+
+    pool_run(job_ptrs, job_count, run_module, parallel ? MODULE_THREADS : 1);
+
+    // remember what the outputs were made with
+    i = 0;
+    for(struct Module *current = modules->next; current; current = current->next) {
+        if(current->func == NULL)
+            continue;
+
+        // printed, but its fingerprint doesn't describe it
+        const bool partial = current->ret == INFO_PARTIAL;
+        if(partial)
+            current->ret = 0;
+
+        if(ran[i] && partial == false && keys[i][0] && current->ret == 0) {
+            strcpy(current->key, keys[i]);
+            current->made = now;
+
+            if(cache)
+                cache_set(current->id, keys[i], current->data, now);
+        }
+        ++i;
+    }
+
+    if(cache)
+        cache_save();
+}
+
+// start a line with the next line of the logo (if it's printed), the spacing and the default color
+static void start_line(struct Render *render, const bool print_logo, unsigned *line) {
+    render_start(render);
+
+    if(print_logo) {
+        render_logo(render, line);
+        render_repeat(render, " ", (size_t)config.spacing);
+    }
+
+    render_append(render, config.color);
+}
+
+// print every module (and what's left of the logo) to out
+static void print_modules(FILE *out, struct Module *modules, const char *format, const bool print_logo, const size_t width, struct Context *ctx) {
+    unsigned line = 1;
+
+    // the whole frame is laid out first, and written at once
+    struct Render render;
+    render_init(&render, width);
+
+    for(struct Module *current = modules->next; current; current = current->next) {
+        if(strcmp(current->id, "separator") == 0) {    // separators are handled differently
+            if(render.last_bytes == 0) // first thing being printed
+                continue;
+
+            // this is the length of the last printed text
+            const size_t taken = strlen_real(config.separator_prefix)
+                                 + (print_logo
+                                    ? strlen_real(config.logo[2])
+                                      + (size_t)config.spacing
+                                    : 0);
+            const size_t len = render.last_width > taken ? render.last_width - taken : 0;
+
+            start_line(&render, print_logo, &line);
+            render_append(&render, current->label);
+            render_repeat(&render, config.separator, len);
+        }
+        else if(strcmp(current->id, "space") == 0) {  // spacings are handled differently (they don't do shit)
+            start_line(&render, print_logo, &line);
+            render_append(&render, current->label);
+        }
+        else if(strcmp(current->id, "title") == 0) {    // titles are handled differently
+            char name[256];
+            char host[256];
+
+            if(user(name, ctx) || hostname(host, ctx))
+                continue;
+
+            start_line(&render, print_logo, &line);
+            render_append(&render, current->label);
+
+            if(title_color)
+                render_appendf(&render, "%s%s%s%s@%s%s%s",
+                    config.color,
+                    bold ? "\033[1m" : "",
+                    name,
+                    "\033[0m",
+                    bold ? "\033[1m" : "",
+                    config.color,
+                    host
+                );
+            else
+                render_appendf(&render, "%s%s@%s",
+                    "\033[0m",
+                    name,
+                    host
+                );
+        }
+        else if(current->func == NULL) {            // printing a custom text
+            start_line(&render, print_logo, &line);
+            render_append(&render, current->id);
+        }
+        else {
+            if(current->ret)
+                continue;
+
+            char label[80];
+
+            start_line(&render, print_logo, &line);
+
+            strcpy(label, current->label);
+            if(current->label[0] && current->func != colors && current->func != light_colors)
+                strcat(label, config.dash);
+
+            render_appendf(&render, format, label, current->data);
+        }
+
+        render_end(&render);
+    }
+
+    // remaining lines
+    while(config.logo[line+1] && print_logo) {
+        render_start(&render);
+        render_logo(&render, &line);
+        render_end(&render);
+    }
+
+    render_write(&render, out);
+    render_free(&render);
+}
+
+// the format every module is printed with, aligned if align is set
+static void module_format(char *dest, const size_t len, struct Module *modules) {
+    if((align) == 0) {
+        snprintf(dest, len, "%%s\033[0m%%s");
+        return;
+    }
+
+    // determining how far the text should be aligned
+    size_t width = 0;
+    for(struct Module *current = modules->next; current; current = current->next) {
+        const size_t current_len = strlen_real(current->label);
+
+        if(current_len > width)
+            width = current_len;
+    }
+
+    width += strlen_real(config.dash);
+
+    snprintf(dest, len, "%%-%ds\033[0m%%s", (int)width);
+}
+
+// the logo called name, NULL if there's none
+static char **find_logo(const char *name) {
+    for(size_t i = 0; i < sizeof(logos)/sizeof(logos[0]); ++i)
+        if(strcmp(logos[i][0], name) == 0)
+            return logos[i];
+
+    return NULL;
+}
+
+// the escape sequence of the color called name, NULL if there's none
+static const char *find_color(const char *name) {
+    const char *colors[][2] = {
+        {"black", "\033[30m"},
+        {"red", "\033[31m"},
+        {"green", "\033[32m"},
+        {"yellow", "\033[33m"},
+        {"blue", "\033[34m"},
+        {"purple", "\033[35m"},
+        {"cyan", "\033[36m"},
+        {"gray", "\033[90m"},
+        {"white", "\033[37m"},
+    };
+
+    for(size_t i = 0; i < sizeof(colors)/sizeof(colors[0]); ++i)
+        if(strcmp(name, colors[i][0]) == 0)
+            return colors[i][1];
+
+    return NULL;
+}
+
+/* fill request in with --logo, --color, --bold and --align (the argument after them is at the given index)
+ * returns 1 if one of them is not valid, a normal run then reports it
+ */
+static int client_flags(struct Request *request, char **argv, const int argc,
+                        const int asking_logo, const int asking_color, const int asking_bold, const int asking_align) {
+    if(asking_logo) {
+        if(asking_logo >= argc || find_logo(argv[asking_logo]) == NULL
+           || strlen(argv[asking_logo]) >= sizeof(request->logo))
+            return 1;
+        strcpy(request->logo, argv[asking_logo]);
+    }
+
+    if(asking_color) {
+        if(asking_color >= argc || find_color(argv[asking_color]) == NULL
+           || strlen(argv[asking_color]) >= sizeof(request->color))
+            return 1;
+        strcpy(request->color, argv[asking_color]);
+    }
+
+    const int switches[][3] = {
+        {asking_bold, DAEMON_BOLD_ON, DAEMON_BOLD_OFF},
+        {asking_align, DAEMON_ALIGN_ON, DAEMON_ALIGN_OFF},
+    };
+
+    for(size_t i = 0; i < sizeof(switches)/sizeof(switches[0]); ++i) {
+        if(switches[i][0] == 0)
+            continue;
+
+        if(switches[i][0] >= argc)
+            return 1;
+        else if(strcmp(argv[switches[i][0]], "on") == 0)
+            request->flags |= (unsigned)switches[i][1];
+        else if(strcmp(argv[switches[i][0]], "off") == 0)
+            request->flags |= (unsigned)switches[i][2];
+        else
+            return 1;
+    }
+
+    return 0;
+}
+
+// called by the daemon for every client
+static void render_frame(FILE *out, const struct Client *client, void *arg) {
+    struct Module *modules = arg;
+    const struct Request *request = &client->request;
+
+    // nothing is shared between two frames, and what depends on the client is fetched for it
+    struct Context ctx;
+    context_init(&ctx);
+    context_set_client(&ctx, client->env, client->cwd, request->parent);
+
+    run_modules(modules, true, true, &ctx);
+
+    // the flags of the client only apply to its own frame
+    const struct Config saved = config;
+    char **logo;
+    const char *color;
+
+    if(request->logo[0] && (logo = find_logo(request->logo))) {
+        config.logo = logo;
+        strcpy(config.color, logo[1]);
+    }
+    if(request->color[0] && (color = find_color(request->color)))
+        strcpy(config.color, color);
+
+    if(request->flags & DAEMON_BOLD_ON)
+        config.options |= ((uint64_t)1 << 1);
+    else if(request->flags & DAEMON_BOLD_OFF)
+        config.options &= ~((uint64_t)1 << 1);
+
+    if(request->flags & DAEMON_ALIGN_ON)
+        config.options |= (uint64_t)1;
+    else if(request->flags & DAEMON_ALIGN_OFF)
+        config.options &= ~((uint64_t)1);
+
+    char format[32];
+    module_format(format, sizeof(format), modules);
+
+    print_modules(out, modules, format, (request->flags & DAEMON_NO_LOGO) == 0, request->width, &ctx);
+
+    config = saved;
+    context_destroy(&ctx);
+}
+
 int main(int argc, char **argv) {
     bool user_is_an_idiot = false; // rtfm and stfu
 
@@ -90,6 +500,8 @@ int main(int argc, char **argv) {
     bool asking_help = false;
     bool use_config = true;
     bool print_logo = true;
+    bool daemon_mode = false;
+    bool client_mode = false;
     int asking_color = 0;
     int asking_bold = 0;
     int asking_logo = 0;
@@ -151,11 +563,29 @@ int main(int argc, char **argv) {
             print_logo = false;
         else if(strcmp(argv[i], "--no-config") == 0)
             use_config = false;
+        else if(strcmp(argv[i], "--daemon") == 0)
+            daemon_mode = true;
+        else if(strcmp(argv[i], "--client") == 0)
+            client_mode = true;
     }
 
-    char data[256] = "";     // output of each module
-    char printed[1024] = ""; // line-by-line output of albafetch
-    
+    /* a running daemon already has everything ready, there's no need to parse anything
+     * it only knows its own config and logos though, a normal run takes care of anything else
+     */
+    if(client_mode && daemon_mode == false && asking_help == false && user_is_an_idiot == false
+       && use_config && config_file[0] == 0 && ascii_file == NULL) {
+        struct Request request;
+        memset(&request, 0, sizeof(request));
+
+        request.width = terminal_width();
+        request.flags = print_logo ? 0 : DAEMON_NO_LOGO;
+
+        if(client_flags(&request, argv, argc, asking_logo, asking_color, asking_bold, asking_align) == 0
+           && daemon_client(&request) == 0)
+            return 0;
+    }
+
+
     struct Module *modules = malloc(sizeof(struct Module));
     modules->id = NULL;
     modules->next = NULL;
@@ -192,11 +622,11 @@ int main(int argc, char **argv) {
         bool found = false;
         if(asking_logo < argc) {
             // find the matching logo
-            for(size_t i = 0; i < sizeof(logos)/sizeof(logos[0]); ++i)
-                if(strcmp(logos[i][0], argv[asking_logo]) == 0) {
-                    config.logo = logos[i];
-                    found = true;
-                }
+            char **logo = find_logo(argv[asking_logo]);
+            if(logo) {
+                config.logo = logo;
+                found = true;
+            }
 
             if(found == false)
                 fprintf(stderr, "\033[31m\033[1mERROR\033[0m: invalid logo \"%s\"! Use --help for more info\n", argv[asking_logo]);
@@ -209,6 +639,10 @@ int main(int argc, char **argv) {
         else
             user_is_an_idiot = true;
     }
+    // everything the modules (and the logo detection) share, fetched when first needed
+    struct Context ctx;
+    context_init(&ctx);
+
     if(config.logo == NULL) {  // get a logo based on the OS (--logo was not used and no logo was set by the config)
         #ifdef __APPLE__
             config.logo = logos[1];
@@ -217,24 +651,11 @@ int main(int argc, char **argv) {
             config.logo = logos[2];
         # else
             config.logo = logos[0];
-            FILE *fp = fopen("/etc/os-release", "r");
-
-            if(fp == NULL)
-                fp = fopen("/usr/lib/os-release", "r");
+            const struct OsRelease *os_release = ctx_os_release(&ctx);
 
-            if(fp != NULL) {
+            if(os_release && os_release->id[0]) {
                 char os_id[48];
-		    // check with a newline first
-                read_after_sequence(fp, "\nID", os_id, 48);
-                if(os_id[0] == 0) {
-                    rewind(fp);
-                    read_after_sequence(fp, "ID", os_id, 48);
-                }
-                fclose(fp);
-
-                char *end = strchr(os_id, '\n');
-                if(end != NULL)
-                    *end = 0;
+                strcpy(os_id, os_release->id);
 
                 // because Arch Linux ARM has to be special for some reason
                 // edit: fedora asahi too, yay
@@ -243,18 +664,6 @@ int main(int argc, char **argv) {
                 else if(strcmp(os_id, "fedora-asahi-remix") == 0)
                     os_id[6] = 0;
 
-                // clean up because of some distros randomly using " or ' when they shouldnt be
-                if(os_id[0] == '\'' || os_id[0] == '"') {
-                    memmove(os_id, os_id+1, strlen(os_id));
-
-                    end = strchr(os_id, '\'');
-                    if(end == NULL)
-                        end = strchr(os_id, '"');
-
-                    if(end != NULL)
-                        *end = 0;
-                }
-
                 // find the matching logo
                 for(size_t i = 0; i < sizeof(logos)/sizeof(*logos); ++i)
                     if(strcmp(logos[i][0], os_id) == 0) {
@@ -271,23 +680,11 @@ int main(int argc, char **argv) {
 
     if(asking_color) {
         if(asking_color < argc) {
-            const char *colors[][2] = {
-                {"black", "\033[30m"},
-                {"red", "\033[31m"},
-                {"green", "\033[32m"},
-                {"yellow", "\033[33m"},
-                {"blue", "\033[34m"},
-                {"purple", "\033[35m"},
-                {"cyan", "\033[36m"},
-                {"gray", "\033[90m"},
-                {"white", "\033[37m"},
-            };
-
-            for(int j = 0; j < 9; ++j)
-                if(strcmp(argv[asking_color], *colors[j]) == 0) {
-                    strcpy(config.color, colors[j][1]);
-                    goto color_done;
-                }
+            const char *color = find_color(argv[asking_color]);
+            if(color) {
+                strcpy(config.color, color);
+                goto color_done;
+            }
 
             fprintf(stderr, "\033[31m\033[1mERROR\033[0m: invalid color \"%s\"! Use --help for more info\n", argv[asking_color]);
         }
@@ -324,6 +721,7 @@ int main(int argc, char **argv) {
     // was it really that hard to type 'albafetch -h'?
     if(user_is_an_idiot) {
         destroy_array(modules);
+        context_destroy(&ctx);
 
         fputs("\033[31m\033[1mFATAL\033[0m: One or multiple errors occurred! Use --help for more info\n", stderr);
 
@@ -333,6 +731,7 @@ int main(int argc, char **argv) {
     if(asking_help) {
         // it won't be used anyway lol
         destroy_array(modules);
+        context_destroy(&ctx);
 
         printf("%s%salbafetch\033[0m - a system fetch utility (v4.2.1)\n",
                config.color, bold ? "\033[1m" : "");
@@ -373,6 +772,13 @@ int main(int argc, char **argv) {
         printf("\t%s%s--no-config\033[0m:\t Ignores any provided or existing config file\n",
                config.color, bold ? "\033[1m" : "");
 
+        printf("\t%s%s--daemon\033[0m:\t Keeps running (in the foreground), serving the output to --client\n",
+               config.color, bold ? "\033[1m" : "");
+
+        printf("\t%s%s--client\033[0m:\t Prints the output of a running --daemon (falls back to a normal run,\n"
+               "\t\t\t   like with --ascii, --config or --no-config)\n",
+               config.color, bold ? "\033[1m" : "");
+
         printf("\nReport a bug: %s%s\033[4mhttps://github.com/alba4k/albafetch/issues\033[0m\n",
                config.color, bold ? "\033[1m" : "");
 
@@ -400,59 +806,45 @@ int main(int argc, char **argv) {
         align_done:;
     }
 
-    // I am deeply sorry for the code you're about to see - I hope you like spaghetti
-    unsigned line = 1;
     char format[32] = "%s\033[0m%s";
 
-    /* getting the terminal width
-     * I start by using stdout
-     * if it is not a terminal (e.g. if the user did albafetch | lolcat) I use stderr
-     * if stderr doesn't work either, I use stdin (albafetch 2>/dev/null | lolcat)
-     * now, let's assume the user is a complete moron and redirects everything. Then I just use an "infinite" width
-     */
-    struct winsize win;
-    win.ws_col = 0;
-    if(ioctl(STDOUT_FILENO, TIOCGWINSZ, &win))
-        if(ioctl(STDERR_FILENO, TIOCGWINSZ, &win))
-            ioctl(STDIN_FILENO, TIOCGWINSZ, &win);
-    if(win.ws_col == 0)
-        win.ws_col = -1;
-
     struct Info {
         char *id;               // module identifier
         char *label;            // module label
-        int (*func)(char *);    // function to run
+        int (*func)(char *, struct Context *);  // function to run
+        int (*fingerprint)(char *); // what invalidates its cached output
     };
     struct Info module_table[] = {
-     // {"identifier", "label", func},
-        {"separator", config.separator_prefix, NULL},
-        {"space", config.spacing_prefix, NULL},
-        {"title", config.title_prefix, NULL},
-        {"user", config.user_prefix, user},
-        {"hostname", config.hostname_prefix, hostname},
-        {"uptime", config.uptime_prefix, uptime},
-        {"os", config.os_prefix, os},
-        {"kernel", config.kernel_prefix, kernel},
-        {"desktop", config.desktop_prefix, desktop},
-        {"gtk_theme", config.gtk_theme_prefix, gtk_theme},
-        {"icon_theme", config.icon_theme_prefix, icon_theme},
-        {"cursor_theme", config.cursor_theme_prefix, cursor_theme},
-        {"shell", config.shell_prefix, shell},
-        {"login_shell", config.login_shell_prefix, login_shell},
-        {"term", config.term_prefix, term},
-        {"packages", config.pkg_prefix, packages},
-        {"host", config.host_prefix, host},
-        {"bios", config.bios_prefix, bios},
-        {"cpu", config.cpu_prefix, cpu},
-        {"gpu", config.gpu_prefix, gpu},
-        {"memory", config.mem_prefix, memory},
-        {"public_ip", config.pub_prefix, public_ip},
-        {"local_ip", config.loc_prefix, local_ip},
-        {"pwd", config.pwd_prefix, pwd},
-        {"date", config.date_prefix, date},
-        {"battery", config.bat_prefix, battery},
-        {"colors", config.colors_prefix, colors},
-        {"light_colors", config.light_colors_prefix, light_colors},
+     // {"identifier", "label", func, fingerprint},
+        {"separator", config.separator_prefix, NULL, NULL},
+        {"space", config.spacing_prefix, NULL, NULL},
+        {"title", config.title_prefix, NULL, NULL},
+        {"user", config.user_prefix, user, NULL},
+        {"hostname", config.hostname_prefix, hostname, NULL},
+        {"uptime", config.uptime_prefix, uptime, NULL},
+        {"os", config.os_prefix, os, fingerprint_os},
+        {"kernel", config.kernel_prefix, kernel, NULL},
+        {"desktop", config.desktop_prefix, desktop, NULL},
+        {"gtk_theme", config.gtk_theme_prefix, gtk_theme, NULL},
+        {"icon_theme", config.icon_theme_prefix, icon_theme, NULL},
+        {"cursor_theme", config.cursor_theme_prefix, cursor_theme, NULL},
+        {"shell", config.shell_prefix, shell, NULL},
+        {"login_shell", config.login_shell_prefix, login_shell, NULL},
+        {"term", config.term_prefix, term, NULL},
+        {"packages", config.pkg_prefix, packages, fingerprint_packages},
+        {"host", config.host_prefix, host, fingerprint_boot},
+        {"bios", config.bios_prefix, bios, fingerprint_boot},
+        {"cpu", config.cpu_prefix, cpu, fingerprint_cpu},
+        {"isa", config.isa_prefix, isa, fingerprint_boot},
+        {"gpu", config.gpu_prefix, gpu, fingerprint_boot},
+        {"memory", config.mem_prefix, memory, NULL},
+        {"public_ip", config.pub_prefix, public_ip, fingerprint_network},
+        {"local_ip", config.loc_prefix, local_ip, NULL},
+        {"pwd", config.pwd_prefix, pwd, NULL},
+        {"date", config.date_prefix, date, NULL},
+        {"battery", config.bat_prefix, battery, NULL},
+        {"colors", config.colors_prefix, colors, NULL},
+        {"light_colors", config.light_colors_prefix, light_colors, NULL},
     };
 
     // this sets the default module order in case it was not set in a config file
@@ -489,154 +881,32 @@ int main(int argc, char **argv) {
             if(strcmp(module_table[i].id, current->id) == 0) {
                 current->label = module_table[i].label;
                 current->func = module_table[i].func;
+                current->fingerprint = module_table[i].fingerprint;
             }
 
-    if(align) {
-        size_t current_len;
-        asking_align = 0;
-
-        // determining how far the text should be aligned
-        for(struct Module *current = modules->next; current; current = current->next) {
-            current_len = strlen_real(current->label);
-
-            if(current_len > (size_t)asking_align)
-                asking_align = (int)current_len;
-        }
-
-        asking_align += (int)strlen_real(config.dash);
-
-        snprintf(format, 32, "%%-%ds\033[0m%%s", asking_align);
-    }
+    module_format(format, sizeof(format), modules);
     
-    // printing every module
-    for(struct Module *current = modules->next; current; current = current->next) {
-        if(strcmp(current->id, "separator") == 0) {    // separators are handled differently
-            if(printed[0] == 0) // first thing being printed
-                continue;
-
-            // this is the length of the last printed text
-            const size_t len = strlen_real(printed)
-                               - strlen_real(config.separator_prefix)
-                               - (print_logo
-                                  ? strlen_real(config.logo[2])
-                                    + config.spacing
-                                  : 0);
+    if(cache)
+        cache_load();
 
-            printed[0] = 0;
+    run_modules(modules, false, daemon_mode, &ctx);
 
-            if(print_logo) {
-                get_logo_line(printed, &line);
+    if(daemon_mode) {
+        int ret = daemon_serve(render_frame, modules);
 
-                for(int i = 0; i < config.spacing; ++i)
-                    strcat(printed, " ");
-            }
-
-            strcat(printed, config.color);
-            strcat(printed, current->label);
-
-            const size_t separator_len = strlen(config.separator);
-            for(size_t i = 0; i < len && strlen(printed) < 1023 - separator_len*i; ++i)
-                strcat(printed, config.separator);
-        }
-        else if(strcmp(current->id, "space") == 0) {  // spacings are handled differently (they don't do shit)
-            printed[0] = 0;
-
-            if(print_logo) {
-                get_logo_line(printed, &line);
-
-                for(int i = 0; i < config.spacing; ++i)
-                    strcat(printed, " ");
-            }
-
-            strcat(printed, config.color);
-            strcat(printed, current->label);
-        }
-        else if(strcmp(current->id, "title") == 0) {    // titles are handled differently
-            char name[256];
-            char host[256];
-
-            if(user(name) || hostname(host))
-                continue;
-
-            printed[0] = 0;
-
-            if(print_logo) {
-                get_logo_line(printed, &line);
-
-                for(int i = 0; i < config.spacing; ++i)
-                    strcat(printed, " ");
-            }
-
-            strcat(printed, config.color);
-            strcat(printed, current->label);
-
-            if(title_color)
-                snprintf(printed+strlen(printed), 1024-strlen(printed), "%s%s%s%s@%s%s%s",
-                    config.color,
-                    bold ? "\033[1m" : "",
-                    name,
-                    "\033[0m",
-                    bold ? "\033[1m" : "",
-                    config.color,
-                    host
-                );
-            else
-                snprintf(printed+strlen(printed), 1024-strlen(printed), "%s%s@%s",
-                    "\033[0m",
-                    name,
-                    host
-                );
-        }
-        else if(current->func == NULL) {            // printing a custom text
-            printed[0] = 0;
-
-            if(print_logo) {
-                get_logo_line(printed, &line);
-
-                for(int i = 0; i < config.spacing; ++i)
-                    strcat(printed, " ");
-            }
-
-            strcat(printed, config.color);
-            strncat(printed, current->id, 1023 - strlen(printed));
-        }
-        else {
-            if((current->func)(data))
-                continue;
-
-            char label[80];
-            printed[0] = 0;
-
-            if(print_logo) {
-                get_logo_line(printed, &line);
-
-                for(int i = 0; i < config.spacing; ++i)
-                    strcat(printed, " ");
-            }
-                
-            strcat(printed, config.color);
-            strcpy(label, current->label);
-            if(current->label[0] && current->func != colors && current->func != light_colors)
-                strcat(label, config.dash);
+        free(ascii_ptr);
+        destroy_array(modules);
+        context_destroy(&ctx);
 
-            snprintf(printed+strlen(printed), 1024-strlen(printed), format, label, data);
-        }
-        
-        print_line(printed, win.ws_col);
+        return ret;
     }
 
-    // remaining lines
-    while(config.logo[line+1] && print_logo) {
-        printed[0] = 0;
-        
-        get_logo_line(printed, &line);
-
-        print_line(printed, win.ws_col);
-    }
+    print_modules(stdout, modules, format, print_logo, terminal_width(), &ctx);
 
     // memory clean up
     free(ascii_ptr);
     destroy_array(modules);
+    context_destroy(&ctx);
 
     return 0;
 }
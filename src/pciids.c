@@ -0,0 +1,279 @@
+#include "pciids.h"
+#include "cache.h"
+#include "utils.h"
+
+#include <string.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define INDEX_MAGIC "albapci1"
+
+// the start of the index, followed by the device table and the names
+struct Header {
+    char magic[8];
+    char source[256];       // path of the pci.ids it was built from
+    uint64_t mtime;         // of the pci.ids
+    uint64_t size;          // of the pci.ids
+    uint32_t device_count;
+    uint32_t names_size;
+};
+
+// an entry of the device table, sorted by id
+struct Device {
+    uint32_t id;            // vendor << 16 | device
+    uint32_t name;          // offset of the (NUL terminated) name
+};
+
+// parse the 4 hex digits at str, -1 if there aren't any
+static long parse_id(const char *str, const char *end) {
+    long id = 0;
+
+    if(end - str < 4)
+        return -1;
+
+    for(int i = 0; i < 4; ++i) {
+        const char c = str[i];
+        int digit;
+
+        if(c >= '0' && c <= '9')
+            digit = c - '0';
+        else if(c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            return -1;
+
+        id = id << 4 | digit;
+    }
+
+    return id;
+}
+
+static int compare_devices(const void *a, const void *b) {
+    const uint32_t x = ((const struct Device *)a)->id;
+    const uint32_t y = ((const struct Device *)b)->id;
+
+    return (x > y) - (x < y);
+}
+
+/* parse the pci.ids at path into an index (as it's saved to the disk)
+ * returns it (to be freed) and saves its size to len, NULL on failure
+ */
+static char *build_index(const char *path, const struct stat *st, size_t *len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return NULL;
+
+    const size_t text_len = (size_t)st->st_size;
+    const char *text = text_len ? mmap(NULL, text_len, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if(text == MAP_FAILED)
+        return NULL;
+
+    madvise((void *)text, text_len, MADV_SEQUENTIAL);
+
+    struct Device *devices = NULL;
+    size_t device_count = 0, device_size = 0;
+    char *names = NULL;
+    size_t names_used = 0, names_size = 0;
+    long vendor = -1;
+    bool failed = false;
+
+    /* vendors start at the beginning of a line, their devices are indented with a tab
+     * (and subsystems with two), comments start with '#'
+     */
+    for(const char *line = text, *end = text + text_len; line < end && failed == false;) {
+        const char *eol = memchr(line, '\n', (size_t)(end - line));
+        if(eol == NULL)
+            eol = end;
+
+        // device classes are listed at the end of the file, nothing else is needed after them
+        if(eol - line >= 2 && line[0] == 'C' && line[1] == ' ')
+            break;
+
+        if(line < eol && line[0] == '\t' && (eol - line < 2 || line[1] != '\t') && vendor >= 0) {
+            const long device = parse_id(line+1, eol);
+            const char *name = line + 5;
+
+            while(name < eol && (*name == ' ' || *name == '\t'))
+                ++name;
+
+            const size_t name_len = (size_t)(eol - name);
+
+            if(device >= 0 && name_len) {
+                if(device_count == device_size) {
+                    device_size = device_size ? device_size*2 : 4096;
+                    struct Device *grown = realloc(devices, device_size * sizeof(*devices));
+                    if(grown == NULL) {
+                        failed = true;
+                        break;
+                    }
+                    devices = grown;
+                }
+                while(names_used + name_len + 1 > names_size) {
+                    names_size = names_size ? names_size*2 : 0x40000;
+                    char *grown = realloc(names, names_size);
+                    if(grown == NULL) {
+                        failed = true;
+                        break;
+                    }
+                    names = grown;
+                }
+                if(failed)
+                    break;
+
+                devices[device_count++] = (struct Device){(uint32_t)(vendor << 16 | device), (uint32_t)names_used};
+                memcpy(names + names_used, name, name_len);
+                names[names_used + name_len] = 0;
+                names_used += name_len + 1;
+            }
+        }
+        else if(line < eol && line[0] != '\t' && line[0] != '#')
+            vendor = parse_id(line, eol);
+
+        line = eol + 1;
+    }
+
+    munmap((void *)text, text_len);
+
+    char *index = NULL;
+
+    if(failed == false) {
+        qsort(devices, device_count, sizeof(*devices), compare_devices);
+
+        const struct Header header = {
+            INDEX_MAGIC, "",
+            (uint64_t)st->st_mtime, (uint64_t)st->st_size,
+            (uint32_t)device_count, (uint32_t)names_used,
+        };
+
+        *len = sizeof(header) + device_count * sizeof(*devices) + names_used;
+        if((index = malloc(*len))) {
+            memcpy(index, &header, sizeof(header));
+            strncpy(((struct Header *)index)->source, path, sizeof(header.source)-1);
+            memcpy(index + sizeof(header), devices, device_count * sizeof(*devices));
+            memcpy(index + sizeof(header) + device_count * sizeof(*devices), names, names_used);
+        }
+    }
+
+    free(devices);
+    free(names);
+
+    return index;
+}
+
+/* look device up in an index of the pci.ids described by path and st
+ * returns 0 on success, 1 if it's not there and -1 if the index is not valid (anymore)
+ */
+static int search_index(const char *index, const size_t len, const char *path, const struct stat *st,
+                        const uint32_t id, char *dest, const size_t dest_len) {
+    const struct Header *header = (const struct Header *)index;
+
+    if(len < sizeof(*header)
+       || memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic))
+       || strncmp(header->source, path, sizeof(header->source))
+       || header->mtime != (uint64_t)st->st_mtime
+       || header->size != (uint64_t)st->st_size
+       || len != sizeof(*header) + (size_t)header->device_count * sizeof(struct Device) + header->names_size)
+        return -1;
+
+    const struct Device *devices = (const struct Device *)(index + sizeof(*header));
+    const char *names = (const char *)(devices + header->device_count);
+    const struct Device key = {id, 0};
+
+    const struct Device *found = bsearch(&key, devices, header->device_count, sizeof(key), compare_devices);
+    if(found == NULL || found->name >= header->names_size)
+        return 1;
+
+    const char *name = names + found->name;
+    const size_t name_len = strnlen(name, header->names_size - found->name);
+    const size_t copied = name_len < dest_len ? name_len : dest_len-1;
+
+    memcpy(dest, name, copied);
+    dest[copied] = 0;
+
+    return 0;
+}
+
+// search the index saved at index_path, -1 if it's missing or stale
+static int search_saved(const char *index_path, const char *path, const struct stat *st,
+                        const uint32_t id, char *dest, const size_t len) {
+    int fd = open(index_path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return -1;
+
+    struct stat index_st;
+    if(fstat(fd, &index_st) || index_st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+
+    const size_t index_len = (size_t)index_st.st_size;
+    const char *index = mmap(NULL, index_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(index == MAP_FAILED)
+        return -1;
+
+    const int ret = search_index(index, index_len, path, st, id, dest, len);
+    munmap((void *)index, index_len);
+
+    return ret;
+}
+
+// write the index to index_path (through a temporary file, like the cache)
+static void save_index(const char *index_path, const char *index, const size_t len) {
+    char tmp[352];
+    snprintf(tmp, sizeof(tmp), "%s.%d", index_path, (int)getpid());
+
+    FILE *fp = fopen(tmp, "w");
+    if(fp == NULL)
+        return;
+
+    const size_t written = fwrite(index, 1, len, fp);
+
+    if(fclose(fp) || written != len || rename(tmp, index_path))
+        unlink(tmp);
+}
+
+int pciids_lookup(const char *path, const unsigned vendor, const unsigned device, char *dest, const size_t len) {
+    struct stat st;
+    char index_path[320];
+
+    if(path == NULL || len == 0 || stat(path, &st))
+        return 1;
+
+    const uint32_t id = (uint32_t)(vendor & 0xffff) << 16 | (device & 0xffff);
+    bool saved = false;
+
+    // the index is only kept on the disk if caching is enabled
+    if(cache && cache_dir(index_path, sizeof(index_path)) == 0) {
+        strncat(index_path, "/pci.ids.idx", sizeof(index_path)-strlen(index_path)-1);
+        saved = true;
+
+        const int ret = search_saved(index_path, path, &st, id, dest, len);
+        if(ret >= 0)
+            return ret;
+    }
+
+    size_t index_len;
+    char *index = build_index(path, &st, &index_len);
+    if(index == NULL)
+        return 1;
+
+    if(saved)
+        save_index(index_path, index, index_len);
+
+    const int ret = search_index(index, index_len, path, &st, id, dest, len);
+    free(index);
+
+    return ret != 0;
+}
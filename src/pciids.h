@@ -0,0 +1,25 @@
+#pragma once
+
+#ifndef PCIIDS_H
+#define PCIIDS_H
+
+#define _GNU_SOURCE
+
+#include <stddef.h>
+
+/*
+ * Looking up device names in pci.ids without parsing its 1+ MB of text
+ * every time: the first lookup builds a binary index of it
+ * (pci.ids.idx in the albafetch cache directory), which later runs map
+ * and binary search. The index remembers the path, mtime and size of the
+ * pci.ids it was built from, and gets rebuilt whenever they change.
+ */
+
+/*
+ * Copy the name of device (e.g. "GA102 [GeForce RTX 3090]") to dest,
+ * using the pci.ids at path. Returns 0 on success, 1 if the device is
+ * unknown or the database could not be read.
+ */
+int pciids_lookup(const char *path, const unsigned vendor, const unsigned device, char *dest, const size_t len);
+
+#endif // PCIIDS_H
@@ -0,0 +1,56 @@
+#include "pool.h"
+
+#include <pthread.h>
+
+struct Pool {
+    void **items;
+    size_t count;
+    size_t next;                // index of the next item to be picked up
+    void (*func)(void *);
+    pthread_mutex_t lock;
+};
+
+// keep picking up items until there are none left
+static void *worker(void *arg) {
+    struct Pool *pool = arg;
+    size_t i;
+
+    while(1) {
+        pthread_mutex_lock(&pool->lock);
+        i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+
+        if(i >= pool->count)
+            break;
+
+        pool->func(pool->items[i]);
+    }
+
+    return NULL;
+}
+
+void pool_run(void **items, size_t count, void (*func)(void *), unsigned threads) {
+    struct Pool pool = {items, count, 0, func, PTHREAD_MUTEX_INITIALIZER};
+
+    if(threads > count)
+        threads = (unsigned)count;
+    if(threads == 0)
+        return;
+
+    // the calling thread is a worker too, tids[threads-1] stays unused
+    pthread_t tids[threads];
+    unsigned started = 0;
+
+    for(unsigned i = 0; i < threads-1; ++i) {
+        if(pthread_create(&tids[started], NULL, worker, &pool))
+            break;  // whatever did not get a thread will be ran by the others
+        ++started;
+    }
+
+    worker(&pool);
+
+    for(unsigned i = 0; i < started; ++i)
+        pthread_join(tids[i], NULL);
+
+    pthread_mutex_destroy(&pool.lock);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/*
+ * Runs func(items[i]) for every one of the count items, using no more
+ * than threads worker threads (the calling thread counts as one of them).
+ * Items are picked up in order, but may finish in any order.
+ * Returns once every item has been processed.
+ */
+void pool_run(void **items, size_t count, void (*func)(void *), unsigned threads);
+
+#endif // POOL_H
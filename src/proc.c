@@ -0,0 +1,213 @@
+#include "proc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+// current time in ms
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+// a pipe that won't leak into commands started by other threads
+static int open_pipe(int pipes[2]) {
+    #ifdef __APPLE__
+        if(pipe(pipes))
+            return 1;
+
+        fcntl(pipes[0], F_SETFD, FD_CLOEXEC);
+        fcntl(pipes[1], F_SETFD, FD_CLOEXEC);
+
+        return 0;
+    #else
+        return pipe2(pipes, O_CLOEXEC) != 0;
+    #endif
+}
+
+int proc_start(struct Proc *proc) {
+    int pipes[2];
+
+    proc->pid = -1;
+    proc->fd = -1;
+    proc->used = 0;
+    proc->status = -1;
+    if(proc->len)
+        proc->buf[0] = 0;
+
+    if(proc->argv == NULL || proc->argv[0] == NULL)
+        return 1;
+
+    if(open_pipe(pipes))
+        return 1;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipes[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    // a process group of its own, so that a timeout kills whole pipelines
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    int error = posix_spawnp(&proc->pid, proc->argv[0], &actions, &attr, proc->argv, environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipes[1]);
+
+    if(error) {
+        close(pipes[0]);
+        proc->pid = -1;
+
+        return 1;
+    }
+
+    proc->fd = pipes[0];
+    proc->deadline = now_ms() + (proc->timeout > 0 ? proc->timeout : PROC_TIMEOUT);
+
+    return 0;
+}
+
+// try to reap proc, returns true once it's gone
+static bool reap(struct Proc *proc, const int flags) {
+    int status;
+    pid_t ret;
+
+    while((ret = waitpid(proc->pid, &status, flags)) < 0 && errno == EINTR);
+
+    if(ret == 0)    // still running
+        return false;
+
+    if(ret == proc->pid && WIFEXITED(status))
+        proc->status = WEXITSTATUS(status);
+    else
+        proc->status = -1;
+
+    proc->pid = 0;
+
+    return true;
+}
+
+// the command took too long
+static void terminate(struct Proc *proc) {
+    kill(-proc->pid, SIGKILL);
+
+    if(proc->fd >= 0) {
+        close(proc->fd);
+        proc->fd = -1;
+    }
+
+    reap(proc, 0);
+    proc->status = -1;
+}
+
+void proc_collect(struct Proc *procs, size_t count) {
+    struct pollfd fds[count + 1];
+    size_t index[count + 1];
+    char scratch[512];
+
+    while(1) {
+        const long now = now_ms();
+        int timeout = -1;
+        nfds_t n = 0;
+        bool exiting = false;
+
+        for(size_t i = 0; i < count; ++i) {
+            struct Proc *proc = procs + i;
+
+            if(proc->pid <= 0)
+                continue;
+
+            if(now >= proc->deadline) {
+                terminate(proc);
+                continue;
+            }
+
+            if(proc->fd < 0) {  // the output is over, but it has not exited yet
+                if(reap(proc, WNOHANG))
+                    continue;
+
+                exiting = true;
+            }
+            else {
+                fds[n].fd = proc->fd;
+                fds[n].events = POLLIN;
+                index[n] = i;
+                ++n;
+            }
+
+            if(timeout < 0 || proc->deadline - now < timeout)
+                timeout = (int)(proc->deadline - now);
+        }
+
+        if(n == 0 && exiting == false)
+            break;
+
+        // there is no fd to tell when a process exits, so check it every now and then
+        if(exiting && timeout > 5)
+            timeout = 5;
+
+        if(poll(fds, n, timeout) < 0) {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+
+        for(nfds_t i = 0; i < n; ++i) {
+            struct Proc *proc = procs + index[i];
+            ssize_t got;
+
+            if(fds[i].revents == 0)
+                continue;
+
+            // once buf is full, the rest gets discarded (the command would get stuck otherwise)
+            if(proc->used + 1 < proc->len)
+                got = read(proc->fd, proc->buf + proc->used, proc->len - 1 - proc->used);
+            else
+                got = read(proc->fd, scratch, sizeof(scratch));
+
+            if(got < 0 && (errno == EINTR || errno == EAGAIN))
+                continue;
+
+            if(got <= 0) {  // EOF
+                close(proc->fd);
+                proc->fd = -1;
+                reap(proc, WNOHANG);
+                continue;
+            }
+
+            if(proc->used + 1 < proc->len)
+                proc->used += (size_t)got;
+        }
+    }
+
+    // anything left (only if poll failed)
+    for(size_t i = 0; i < count; ++i)
+        if(procs[i].pid > 0)
+            terminate(procs + i);
+
+    for(size_t i = 0; i < count; ++i) {
+        struct Proc *proc = procs + i;
+
+        if(proc->len == 0 || proc->argv == NULL)
+            continue;
+
+        if(proc->used && proc->buf[proc->used-1] == '\n')
+            --proc->used;
+        proc->buf[proc->used] = 0;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#ifndef PROC_H
+#define PROC_H
+
+#define _GNU_SOURCE
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// default time (in ms) a command is allowed to run for
+#define PROC_TIMEOUT 2000
+
+// a command whose stdout is collected into buf
+struct Proc {
+    char *const *argv;  // command to run, NULL terminated (NULL to skip)
+    char *buf;          // where the output (without the last newline) is saved
+    size_t len;         // size of buf
+    int timeout;        // in ms, the command gets killed after this
+
+    // set by proc_start() and proc_collect()
+    pid_t pid;
+    int fd;             // read end of the stdout pipe, -1 when closed
+    size_t used;        // bytes saved in buf
+    long deadline;      // in ms, on the CLOCK_MONOTONIC scale
+    int status;         // exit code, -1 if it could not be started or was killed
+};
+
+/*
+ * Starts proc (without waiting for it), with stdout going to a pipe
+ * and stderr to /dev/null. Returns 0 if the command was started.
+ */
+int proc_start(struct Proc *proc);
+
+/*
+ * Reads the output of every started proc until EOF, killing whatever
+ * runs past its timeout, and reaps all of them.
+ * Procs that were not started are left alone.
+ */
+void proc_collect(struct Proc *procs, size_t count);
+
+#endif // PROC_H
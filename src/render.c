@@ -0,0 +1,196 @@
+#include "render.h"
+#include "utils.h"
+
+#include <string.h>
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// make room for len more bytes, returns 1 if it failed
+static int reserve(struct Render *render, const size_t len) {
+    if(render->failed)
+        return 1;
+
+    if(render->len + len <= render->size)
+        return 0;
+
+    size_t size = render->size ? render->size : 4096;
+    while(size < render->len + len)
+        size *= 2;
+
+    char *grown = realloc(render->buf, size);
+    if(grown == NULL) {
+        render->failed = true;
+        return 1;
+    }
+
+    render->buf = grown;
+    render->size = size;
+
+    return 0;
+}
+
+// append len bytes that are not part of the visible text of the line
+static void append_raw(struct Render *render, const char *str, const size_t len) {
+    if(reserve(render, len))
+        return;
+
+    memcpy(render->buf + render->len, str, len);
+    render->len += len;
+}
+
+// append len bytes of str to the current line, leaving out whatever goes past maxlen
+static void append_text(struct Render *render, const char *str, const size_t len) {
+    if(reserve(render, len))
+        return;
+
+    char *dest = render->buf + render->len;
+    render->bytes += len;
+
+    for(size_t i = 0; i < len && render->newline == false; ++i) {
+        const char c = str[i];
+
+        if(render->width < render->maxlen)
+            *dest++ = c;
+
+        if(c == '\n')
+            render->newline = true;
+        else if(c == '\033')
+            render->escaping = true;
+        else if(c & 0x80) {
+            if(c & 0x40) {                  // first byte of a unicode character
+                if((c & 0x20) == 0)
+                    render->unicode = 1;    // 0b110xxxxx
+                else if((c & 0x10) == 0)
+                    render->unicode = 2;    // 0b1110xxxx
+                else
+                    render->unicode = 3;    // 0b11110xxx
+            }
+            else if(render->unicode-- == 1) // its last continuation byte (0b10xxxxxx)
+                ++render->width;
+        }
+        else {
+            // an escape sequence ends with 'm', nothing in it is visible
+            render->width += (size_t)1-render->escaping;
+            render->escaping = c != 'm' && render->escaping;
+        }
+    }
+
+    render->len = (size_t)(dest - render->buf);
+}
+
+void render_init(struct Render *render, const size_t maxlen) {
+    memset(render, 0, sizeof(*render));
+    render->maxlen = maxlen;
+}
+
+void render_free(struct Render *render) {
+    free(render->buf);
+    render->buf = NULL;
+    render->len = render->size = 0;
+}
+
+void render_start(struct Render *render) {
+    render->width = render->bytes = 0;
+    render->escaping = render->newline = false;
+    render->unicode = 0;
+
+    if(bold)
+        append_raw(render, "\033[1m", 4);
+    append_raw(render, config.color, strlen(config.color));
+}
+
+void render_append(struct Render *render, const char *str) {
+    append_text(render, str, strlen(str));
+}
+
+void render_repeat(struct Render *render, const char *str, size_t count) {
+    const size_t len = strlen(str);
+
+    // nothing more would be visible anyway
+    while(count-- && render->newline == false && render->width < render->maxlen)
+        append_text(render, str, len);
+}
+
+void render_appendf(struct Render *render, const char *format, ...) {
+    char buf[1024];
+    va_list args;
+
+    va_start(args, format);
+    const int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if(len < 0)
+        return;
+
+    if((size_t)len < sizeof(buf)) {
+        append_text(render, buf, (size_t)len);
+        return;
+    }
+
+    // too big for the stack
+    char *big = malloc((size_t)len + 1);
+    if(big == NULL) {
+        render->failed = true;
+        return;
+    }
+
+    va_start(args, format);
+    vsnprintf(big, (size_t)len + 1, format, args);
+    va_end(args);
+
+    append_text(render, big, (size_t)len);
+    free(big);
+}
+
+void render_logo(struct Render *render, unsigned *line) {
+    if(config.logo == NULL || *line < 1)
+        return;
+
+    if(config.logo[(*line)+1]) {
+        ++(*line);
+        render_append(render, config.logo[*line]);
+    }
+    else
+        render_repeat(render, " ", strlen_real(config.logo[2]));
+}
+
+void render_end(struct Render *render) {
+    append_raw(render, "\033[0m\n", 5);
+
+    render->last_width = render->width;
+    render->last_bytes = render->bytes;
+}
+
+int render_write(const struct Render *render, FILE *out) {
+    if(render->failed)
+        return 1;
+
+    const int fd = fileno(out);
+
+    // the daemon renders to a memory stream, which has no descriptor
+    if(fd < 0)
+        return fwrite(render->buf, 1, render->len, out) != render->len;
+
+    fflush(out);
+
+    const char *buf = render->buf;
+    size_t len = render->len;
+
+    while(len) {
+        const ssize_t written = write(fd, buf, len);
+
+        if(written < 0) {
+            if(errno == EINTR)
+                continue;
+            return 1;
+        }
+
+        buf += written;
+        len -= (size_t)written;
+    }
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * The whole output is laid out in a single growable buffer, and written
+ * with one write() once it's complete.
+ * The visible width of the current line is tracked while it's appended
+ * (escape sequences and unicode continuation bytes don't count), and
+ * whatever goes past the width of the terminal is left out right away.
+ */
+
+struct Render {
+    char *buf;
+    size_t len;
+    size_t size;
+    size_t maxlen;      // visible characters a line is cut at
+    bool failed;        // an allocation failed, nothing gets written
+
+    // the line being appended
+    size_t width;       // visible characters so far (including what was cut, up to a newline)
+    size_t bytes;       // bytes appended so far (including what was cut)
+    bool escaping;
+    int unicode;        // continuation bytes left in the current character
+    bool newline;       // the rest of the line is left out after a newline
+
+    // the last line that was ended
+    size_t last_width;
+    size_t last_bytes;
+};
+
+// set up an empty frame, lines will be cut at maxlen visible characters
+void render_init(struct Render *render, const size_t maxlen);
+
+// free the buffer of render
+void render_free(struct Render *render);
+
+// start a line (in bold, if it's enabled, and in the default color)
+void render_start(struct Render *render);
+
+// append str to the current line
+void render_append(struct Render *render, const char *str);
+
+// append str count times
+void render_repeat(struct Render *render, const char *str, size_t count);
+
+// append the output of printf(format, ...)
+void render_appendf(struct Render *render, const char *format, ...);
+
+// append the next line of the logo, or spaces as wide as it once it's over
+void render_logo(struct Render *render, unsigned *line);
+
+// reset the colors and end the current line
+void render_end(struct Render *render);
+
+// write the whole frame to out, 0 on success
+int render_write(const struct Render *render, FILE *out);
+
+#endif // RENDER_H
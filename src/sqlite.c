@@ -0,0 +1,279 @@
+#include "sqlite.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// b-tree page types
+#define PAGE_INTERIOR_TABLE 0x05
+#define PAGE_LEAF_TABLE     0x0d
+
+// no real database is anywhere near this deep, a loop in a corrupted file could be
+#define MAX_DEPTH 32
+
+struct Database {
+    const uint8_t *map;
+    size_t len;
+    size_t page_size;
+    size_t usable_size;     // page size without the reserved bytes at the end of each page
+    size_t page_count;
+};
+
+static uint32_t read_be16(const uint8_t *ptr) {
+    return (uint32_t)ptr[0] << 8 | ptr[1];
+}
+
+static uint32_t read_be32(const uint8_t *ptr) {
+    return (uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 | (uint32_t)ptr[2] << 8 | ptr[3];
+}
+
+// read a varint at ptr (without going past end), returns its length or 0 if it's cut off
+static size_t read_varint(const uint8_t *ptr, const uint8_t *end, uint64_t *value) {
+    *value = 0;
+
+    for(size_t i = 0; i < 9; ++i) {
+        if(ptr + i >= end)
+            return 0;
+
+        if(i == 8) {    // the 9th byte is used as a whole
+            *value = *value << 8 | ptr[i];
+            return 9;
+        }
+
+        *value = *value << 7 | (ptr[i] & 0x7f);
+        if((ptr[i] & 0x80) == 0)
+            return i+1;
+    }
+
+    return 0;
+}
+
+// start of page (1-based), NULL if it's not in the file
+static const uint8_t *get_page(const struct Database *db, const uint32_t page) {
+    if(page == 0 || page > db->page_count)
+        return NULL;
+
+    return db->map + (size_t)(page-1) * db->page_size;
+}
+
+// b-tree header of page, which comes after the file header on page 1
+static const uint8_t *page_header(const uint8_t *start, const uint32_t page) {
+    return page == 1 ? start + 100 : start;
+}
+
+/* call func on every cell of the table b-tree rooted at page
+ * func gets the page (to resolve offsets) and the start of the cell, and returns nonzero to stop
+ * returns 1 if the tree is malformed
+ */
+static int walk_table(const struct Database *db, const uint32_t page, const unsigned depth,
+                      int (*func)(const struct Database *, const uint8_t *, const uint8_t *, void *), void *arg,
+                      unsigned long *leaf_cells) {
+    if(depth > MAX_DEPTH)
+        return 1;
+
+    const uint8_t *start = get_page(db, page);
+    if(start == NULL)
+        return 1;
+
+    const uint8_t *header = page_header(start, page);
+    const uint32_t cells = read_be16(header + 3);
+
+    if(header[0] == PAGE_LEAF_TABLE) {
+        if(leaf_cells)
+            *leaf_cells += cells;
+
+        if(func == NULL)
+            return 0;
+
+        const uint8_t *pointers = header + 8;
+        if(pointers + 2*cells > start + db->usable_size)
+            return 1;
+
+        for(uint32_t i = 0; i < cells; ++i) {
+            const uint32_t offset = read_be16(pointers + 2*i);
+            if(offset >= db->usable_size)
+                return 1;
+
+            if(func(db, start, start + offset, arg))
+                return 0;
+        }
+
+        return 0;
+    }
+
+    if(header[0] != PAGE_INTERIOR_TABLE)
+        return 1;
+
+    const uint8_t *pointers = header + 12;
+    if(pointers + 2*cells > start + db->usable_size)
+        return 1;
+
+    // every cell starts with the page number of its left child
+    for(uint32_t i = 0; i < cells; ++i) {
+        const uint32_t offset = read_be16(pointers + 2*i);
+        if(offset + 4 > db->usable_size)
+            return 1;
+
+        if(walk_table(db, read_be32(start + offset), depth+1, func, arg, leaf_cells))
+            return 1;
+    }
+
+    return walk_table(db, read_be32(header + 8), depth+1, func, arg, leaf_cells);
+}
+
+// size of a column of a given serial type
+static uint64_t serial_size(const uint64_t type) {
+    static const uint8_t sizes[] = {0, 1, 2, 3, 4, 6, 8, 8, 0, 0, 0, 0};
+
+    if(type < 12)
+        return sizes[type];
+
+    return (type - 12) / 2;
+}
+
+// value of an integer column
+static uint64_t serial_int(const uint8_t *ptr, const uint64_t type) {
+    const uint64_t size = serial_size(type);
+    uint64_t value = 0;
+
+    if(type == 8)
+        return 0;
+    if(type == 9)
+        return 1;
+
+    for(uint64_t i = 0; i < size; ++i)
+        value = value << 8 | ptr[i];
+
+    return value;
+}
+
+// what is being looked for in sqlite_schema
+struct Lookup {
+    const char *table;
+    uint32_t root;
+};
+
+/* a sqlite_schema row is (type, name, tbl_name, rootpage, sql)
+ * only the first four columns are read, so the part that overflows
+ * to other pages (if any) is never needed for the tables looked up here
+ */
+static int find_table(const struct Database *db, const uint8_t *page, const uint8_t *cell, void *arg) {
+    struct Lookup *lookup = arg;
+    const uint8_t *end = page + db->usable_size;
+    uint64_t payload_len, rowid, header_len;
+    size_t used;
+
+    if((used = read_varint(cell, end, &payload_len)) == 0)
+        return 0;
+    cell += used;
+    if((used = read_varint(cell, end, &rowid)) == 0)
+        return 0;
+    cell += used;
+
+    // the part of the payload stored in this page
+    const uint64_t max_local = db->usable_size - 35;
+    uint64_t local = payload_len;
+    if(local > max_local) {
+        const uint64_t min_local = (db->usable_size - 12) * 32 / 255 - 23;
+        local = min_local + (payload_len - min_local) % (db->usable_size - 4);
+        if(local > max_local)
+            local = min_local;
+    }
+    if(cell + local <= end)
+        end = cell + local;
+
+    const uint8_t *record = cell;
+    if((used = read_varint(record, end, &header_len)) == 0 || header_len > (uint64_t)(end - record))
+        return 0;
+
+    uint64_t types[4];
+    const uint8_t *ptr = record + used;
+    for(int i = 0; i < 4; ++i) {
+        if((used = read_varint(ptr, record + header_len, types + i)) == 0)
+            return 0;
+        ptr += used;
+    }
+
+    const uint8_t *body = record + header_len;
+    const uint8_t *columns[4];
+    for(int i = 0; i < 4; ++i) {
+        columns[i] = body;
+        body += serial_size(types[i]);
+    }
+    if(body > end)
+        return 0;
+
+    const size_t table_len = strlen(lookup->table);
+    const bool is_table = types[0] == 13 + 2*5 && memcmp(columns[0], "table", 5) == 0;
+    const bool is_name = types[1] == 13 + 2*table_len && memcmp(columns[1], lookup->table, table_len) == 0;
+
+    if(is_table && is_name && types[3] >= 1 && types[3] <= 9 && types[3] != 7) {
+        lookup->root = (uint32_t)serial_int(columns[3], types[3]);
+        return 1;
+    }
+
+    return 0;
+}
+
+int sqlite_count_rows(const char *path, const char *table, unsigned long *count) {
+    struct stat st;
+    char wal[320];
+
+    // whatever is in the write-ahead log is not in the main file yet
+    snprintf(wal, sizeof(wal), "%s-wal", path);
+    if(stat(wal, &st) == 0 && st.st_size > 0)
+        return 1;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return 1;
+
+    if(fstat(fd, &st) || st.st_size < 512) {
+        close(fd);
+        return 1;
+    }
+
+    struct Database db;
+    db.len = (size_t)st.st_size;
+    db.map = mmap(NULL, db.len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(db.map == MAP_FAILED)
+        return 1;
+
+    int ret = 1;
+
+    // the header is described in section 1.3 of the file format
+    if(memcmp(db.map, "SQLite format 3", 16))
+        goto done;
+
+    db.page_size = read_be16(db.map + 16);
+    if(db.page_size == 1)
+        db.page_size = 65536;
+    if(db.page_size < 512 || (db.page_size & (db.page_size-1)))
+        goto done;
+
+    db.usable_size = db.page_size - db.map[20];
+    db.page_count = db.len / db.page_size;
+
+    // text encoding, names are only compared as UTF-8
+    if(read_be32(db.map + 56) != 1)
+        goto done;
+
+    struct Lookup lookup = {table, 0};
+    if(walk_table(&db, 1, 0, find_table, &lookup, NULL) || lookup.root == 0)
+        goto done;
+
+    *count = 0;
+    ret = walk_table(&db, lookup.root, 0, NULL, NULL, count);
+
+    done:
+    munmap((void *)db.map, db.len);
+
+    return ret;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#ifndef SQLITE_H
+#define SQLITE_H
+
+#define _GNU_SOURCE
+
+/*
+ * A minimal, read-only reader for SQLite 3 database files, which only knows
+ * how to count the rows of a table (by walking its b-tree).
+ * https://www.sqlite.org/fileformat.html
+ *
+ * Anything it can't handle for sure (an uncommitted write-ahead log, a
+ * UTF-16 database, a corrupted file) makes it fail rather than guess,
+ * so that the caller can fall back to something else.
+ */
+
+// count the rows of table in the database at path, 0 on success
+int sqlite_count_rows(const char *path, const char *table, unsigned long *count);
+
+#endif // SQLITE_H
@@ -0,0 +1,258 @@
+#include "themes.h"
+#include "gvdb.h"
+#include "keyval.h"
+#include "utils.h"
+
+#include <string.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+// the end of the line starting at ptr
+static const char *line_end(const char *ptr, const char *end) {
+    const char *eol = memchr(ptr, '\n', (size_t)(end - ptr));
+
+    return eol ? eol : end;
+}
+
+/* copy the value of key in [section] of the ini file in buf to dest, unless dest is set already
+ * spaces around the '=' are allowed, and so are quotes around the value
+ */
+static void ini_value(const char *buf, const size_t len, const char *section, const char *key,
+                      char *dest, const size_t dest_len) {
+    if(dest[0])
+        return;
+
+    const size_t section_len = strlen(section), key_len = strlen(key);
+    const char *end = buf + len;
+    bool inside = false;
+
+    for(const char *line = buf; line < end; line = line_end(line, end) + 1) {
+        const char *eol = line_end(line, end);
+
+        if(line[0] == '[') {
+            inside = (size_t)(eol - line) >= section_len + 2 && line[section_len+1] == ']'
+                     && memcmp(line+1, section, section_len) == 0;
+            continue;
+        }
+
+        if(inside == false || (size_t)(eol - line) <= key_len || memcmp(line, key, key_len))
+            continue;
+
+        const char *value = line + key_len;
+        while(value < eol && *value == ' ')
+            ++value;
+        if(value == eol || *value != '=')
+            continue;
+        ++value;
+
+        // without the spaces and quotes around the value
+        const char *stop = eol;
+        while(value < stop && *value == ' ')
+            ++value;
+        while(stop > value && (stop[-1] == ' ' || stop[-1] == '\r'))
+            --stop;
+        if(stop - value >= 2 && (*value == '"' || *value == '\'') && stop[-1] == *value) {
+            ++value;
+            --stop;
+        }
+
+        const size_t copied = (size_t)(stop - value) < dest_len ? (size_t)(stop - value) : dest_len-1;
+        memcpy(dest, value, copied);
+        dest[copied] = 0;
+
+        return;
+    }
+}
+
+// read the ini file at config_dir/name and look every key up in it
+static void ini_read(const char *config_dir, const char *name, const char *section,
+                     const char *const *keys, char *const *dests, const size_t count, const size_t dest_len) {
+    char path[320], buf[16384];
+
+    snprintf(path, sizeof(path), "%s/%s", config_dir, name);
+
+    const long len = keyval_read(path, buf, sizeof(buf));
+    if(len <= 0)
+        return;
+
+    for(size_t i = 0; i < count; ++i)
+        if(keys[i])
+            ini_value(buf, (size_t)len, section, keys[i], dests[i], dest_len);
+}
+
+// copy the (quoted) value of key in the output of gsettings list-recursively to dest, unless it is set already
+static void gsettings_value(const char *buf, const char *key, char *dest, const size_t dest_len) {
+    if(dest[0])
+        return;
+
+    // every line looks like "org.gnome.desktop.interface gtk-theme 'Adwaita'"
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), " %s '", key);
+
+    const char *value = strstr(buf, pattern);
+    if(value == NULL)
+        return;
+    value += strlen(pattern);
+
+    const char *end = strchr(value, '\'');
+    if(end == NULL)
+        return;
+
+    const size_t len = (size_t)(end - value) < dest_len ? (size_t)(end - value) : dest_len-1;
+    memcpy(dest, value, len);
+    dest[len] = 0;
+}
+
+/* look the themes up in every database of the dconf profile, in order
+ * a profile lists them like "user-db:user" and "system-db:local"
+ */
+static void dconf_read(struct Context *ctx, const char *config_dir, struct GvdbKey *keys, const size_t count) {
+    const char *profile = ctx_getenv(ctx, "DCONF_PROFILE");
+    char path[320], buf[4096];
+    long len = -1;
+
+    if(profile && profile[0] == '/')
+        len = keyval_read(profile, buf, sizeof(buf));
+    else {
+        if(profile == NULL || profile[0] == 0 || strchr(profile, '/'))
+            profile = "user";
+
+        snprintf(path, sizeof(path), "/etc/dconf/profile/%s", profile);
+        if((len = keyval_read(path, buf, sizeof(buf))) < 0) {
+            snprintf(path, sizeof(path), "/usr/share/dconf/profile/%s", profile);
+            len = keyval_read(path, buf, sizeof(buf));
+        }
+    }
+
+    // without a profile, only the user database is used
+    if(len < 0) {
+        if(config_dir) {
+            snprintf(path, sizeof(path), "%s/dconf/user", config_dir);
+            gvdb_strings(path, NULL, keys, count);
+        }
+
+        return;
+    }
+
+    const char *end = buf + len;
+    for(const char *line = buf; line < end; line = line_end(line, end) + 1) {
+        const char *eol = line_end(line, end);
+        while(eol > line && (eol[-1] == ' ' || eol[-1] == '\t' || eol[-1] == '\r'))
+            --eol;
+        const int line_len = (int)(eol - line);
+
+        if(line_len > 8 && memcmp(line, "user-db:", 8) == 0 && config_dir)
+            snprintf(path, sizeof(path), "%s/dconf/%.*s", config_dir, line_len - 8, line + 8);
+        else if(line_len > 10 && memcmp(line, "system-db:", 10) == 0)
+            snprintf(path, sizeof(path), "/etc/dconf/db/%.*s", line_len - 10, line + 10);
+        else if(line_len > 8 && memcmp(line, "file-db:", 8) == 0)
+            snprintf(path, sizeof(path), "%.*s", line_len - 8, line + 8);
+        else
+            continue;
+
+        gvdb_strings(path, NULL, keys, count);
+    }
+}
+
+/* look the defaults up in the compiled GSettings schemas, in the same order GSettings does:
+ * $GSETTINGS_SCHEMA_DIR, $XDG_DATA_HOME and then every directory in $XDG_DATA_DIRS
+ */
+static void schemas_read(struct Context *ctx, struct GvdbKey *keys, const size_t count) {
+    const char *schema_dir = ctx_getenv(ctx, "GSETTINGS_SCHEMA_DIR");
+    const char *data_home = ctx_getenv(ctx, "XDG_DATA_HOME");
+    const char *data_dirs = ctx_getenv(ctx, "XDG_DATA_DIRS");
+    const char *home = ctx_getenv(ctx, "HOME");
+    char path[320];
+
+    if(schema_dir && schema_dir[0]) {
+        snprintf(path, sizeof(path), "%s/gschemas.compiled", schema_dir);
+        gvdb_strings(path, "org.gnome.desktop.interface", keys, count);
+    }
+
+    if(data_home && data_home[0])
+        snprintf(path, sizeof(path), "%s/glib-2.0/schemas/gschemas.compiled", data_home);
+    else if(home && home[0])
+        snprintf(path, sizeof(path), "%s/.local/share/glib-2.0/schemas/gschemas.compiled", home);
+    else
+        path[0] = 0;
+    if(path[0])
+        gvdb_strings(path, "org.gnome.desktop.interface", keys, count);
+
+    if(data_dirs == NULL || data_dirs[0] == 0)
+        data_dirs = "/usr/local/share:/usr/share";
+
+    for(const char *dir = data_dirs; *dir;) {
+        const size_t dir_len = strcspn(dir, ":");
+
+        if(dir_len) {
+            snprintf(path, sizeof(path), "%.*s/glib-2.0/schemas/gschemas.compiled", (int)dir_len, dir);
+            gvdb_strings(path, "org.gnome.desktop.interface", keys, count);
+        }
+
+        dir += dir_len;
+        if(*dir == ':')
+            ++dir;
+    }
+}
+
+void themes_read(struct Themes *themes, struct Context *ctx) {
+    char *const dests[] = {themes->gtk, themes->icon, themes->cursor};
+    const size_t len = sizeof(themes->gtk);
+
+    themes->gtk[0] = themes->icon[0] = themes->cursor[0] = 0;
+
+    const char *config_home = ctx_getenv(ctx, "XDG_CONFIG_HOME");
+    const char *home = ctx_getenv(ctx, "HOME");
+    char config_dir[256] = "";
+
+    if(config_home && config_home[0])
+        snprintf(config_dir, sizeof(config_dir), "%s", config_home);
+    else if(home && home[0])
+        snprintf(config_dir, sizeof(config_dir), "%s/.config", home);
+
+    struct GvdbKey dconf[] = {
+        {"/org/gnome/desktop/interface/gtk-theme", themes->gtk, len},
+        {"/org/gnome/desktop/interface/icon-theme", themes->icon, len},
+        {"/org/gnome/desktop/interface/cursor-theme", themes->cursor, len},
+    };
+    dconf_read(ctx, config_dir[0] ? config_dir : NULL, dconf, 3);
+
+    if(config_dir[0]) {
+        const char *const gtk_keys[] = {"gtk-theme-name", "gtk-icon-theme-name", "gtk-cursor-theme-name"};
+        ini_read(config_dir, "gtk-3.0/settings.ini", "Settings", gtk_keys, dests, 3, len);
+        ini_read(config_dir, "gtk-4.0/settings.ini", "Settings", gtk_keys, dests, 3, len);
+
+        // KDE only sets the GTK theme through the files above
+        const char *const icon_key[] = {NULL, "Theme", NULL};
+        const char *const cursor_key[] = {NULL, NULL, "cursorTheme"};
+        ini_read(config_dir, "kdeglobals", "Icons", icon_key, dests, 3, len);
+        ini_read(config_dir, "kcminputrc", "Mouse", cursor_key, dests, 3, len);
+    }
+
+    // whatever is still missing has its default value
+    struct GvdbKey schema[] = {
+        {"gtk-theme", themes->gtk, len},
+        {"icon-theme", themes->icon, len},
+        {"cursor-theme", themes->cursor, len},
+    };
+    schemas_read(ctx, schema, 3);
+}
+
+void themes_gsettings(struct Themes *themes) {
+    const size_t len = sizeof(themes->gtk);
+
+    themes->gtk[0] = themes->icon[0] = themes->cursor[0] = 0;
+
+    if(access("/bin/gsettings", F_OK))
+        return;
+
+    // a single call for all of them
+    char buf[8192] = "";
+    char *args[] = {"gsettings", "list-recursively", "org.gnome.desktop.interface", NULL};
+    exec_cmd(buf, sizeof(buf), args);
+
+    gsettings_value(buf, "gtk-theme", themes->gtk, len);
+    gsettings_value(buf, "icon-theme", themes->icon, len);
+    gsettings_value(buf, "cursor-theme", themes->cursor, len);
+}
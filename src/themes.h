@@ -0,0 +1,28 @@
+#pragma once
+
+#ifndef THEMES_H
+#define THEMES_H
+
+#define _GNU_SOURCE
+
+#include "context.h"
+
+/*
+ * Reading the GTK, icon and cursor themes without asking gsettings,
+ * from (in order of preference):
+ * - the databases of the dconf profile (~/.config/dconf/user and /etc/dconf/db)
+ * - ~/.config/gtk-3.0/settings.ini and ~/.config/gtk-4.0/settings.ini
+ * - ~/.config/kdeglobals and ~/.config/kcminputrc
+ * - the defaults in the compiled GSettings schemas (gschemas.compiled)
+ */
+
+// fill themes with whatever is found, empty strings are left for the rest
+void themes_read(struct Themes *themes, struct Context *ctx);
+
+/*
+ * Fill themes with the output of gsettings (a single run for all of them),
+ * for when schemas are somewhere themes_read() doesn't know about.
+ */
+void themes_gsettings(struct Themes *themes);
+
+#endif // THEMES_H
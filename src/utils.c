@@ -1,14 +1,15 @@
 #include "logos.h"
+#include "proc.h"
 #include "utils.h"
 
 #define _GNU_SOURCE
 
 #include <string.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include <unistd.h>
-#include <sys/wait.h>
 
 // copy an ascii art from file to mem
 void *file_to_logo(char *file) {
@@ -118,6 +119,11 @@ void add_module(struct Module *array, char *id) {
 
     new->label = NULL;
     new->func = NULL;
+    new->fingerprint = NULL;
+    new->data[0] = 0;
+    new->ret = 1;
+    new->key[0] = 0;
+    new->made = 0;
 
     new->next = NULL;
 }
@@ -135,205 +141,157 @@ void destroy_array(struct Module *array) {
     }
 }
 
-// print a certain line of the logo
-void get_logo_line(char *dest, unsigned *line) {
-    if(config.logo == NULL || dest == NULL || *line < 1)
-        return;
-        
-    if(config.logo[(*line)+1]) {
-        ++(*line);
-        strcat(dest, config.logo[*line]);
-    }
-    else {
-        for(size_t i = 0; i < strlen_real(config.logo[2]); ++i)
-            strcat(dest, " ");
+// what kind of value an option holds
+enum OptionType {
+    OPTION_STR,     // copied to dest, no more than arg bytes (including the NUL)
+    OPTION_INT,     // saved to dest, ignored if bigger than arg
+    OPTION_BOOL,    // saved as bit arg of config.options
+};
+
+// an option parse_config() knows about
+struct Option {
+    const char *key;
+    enum OptionType type;
+    void *dest;
+    unsigned long arg;
+};
+
+// an entry of the hash table of options
+struct Slot {
+    const struct Option *option;    // NULL if the slot is empty
+    size_t key_len;
+    bool seen;                      // only the first occurrence of every key counts
+};
+
+// power of two, at least twice the number of options
+#define OPTION_SLOTS 256
+
+// FNV-1a
+static uint32_t hash_key(const char *key, const size_t len) {
+    uint32_t hash = 2166136261u;
+
+    for(size_t i = 0; i < len; ++i) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
     }
-}
-
-// print no more than maxlen visible characters of line
-void print_line(char *line, const size_t maxlen) {
-    if(bold)
-        fputs("\033[1m", stdout);
-    fputs(config.color, stdout);
-
-    bool escaping = false;
-    int unicode = 0;
-
-    for(size_t i = 0, len = 0; len < maxlen && i < strlen(line); ++i) {
-            putc(line[i], stdout);
 
-            if(line[i] == '\n')
-                break;
-            else if(line[i] == '\033')
-                escaping = true;
-            else if(line[i] & 0x80) {       // is the 1st bit 1?
-                if(line[i] & 0x40) {        // is the 2nd bit 1?
-                    if(line[i] & 0x20) {    // is the 3rd bit 1?
-                        if(line[i] & 0x10)  // is the 4th bit 1?
-                            unicode = 3;    // first of 4 unicode bytes (0b11110xxx)
-                        else
-                            unicode = 2;    // first of 3 unicode bytes (0b1110xxxx)
-                    }
-                    else
-                        unicode = 1;        // first of 2 unicode bytes (0b110xxxxx)
-                }
-                else if(unicode-- == 1)     // unicode continuation byte (0b10xxxxxx)
-                    ++len;
-            }
-            else {
-                // look mom, I just wanted to try to write some branchless code
-
-                // this line is a bit weird
-                // ++len <=> escaping == 0
-                len += (size_t)1-escaping;
-
-                /* m is found     and escaping     => escaping = 0
-                 * m is found     and not escaping => escaping = 0
-                 * m is not found and escaping     => escaping = 1
-                 * m is not found and not escaping => escaping = 0
-                 */
-                escaping = (line[i] != 'm') && escaping;
-            }
-        }
-
-    fputs("\033[0m\n", stdout);
+    return hash;
 }
 
-// a return code of 0 means that the option was parsed successfully
-int parse_config_str(const char* source, const char *field, char *dest, const size_t maxlen) {
-    char *ptr, *end;
+// add option to an open addressing hash table
+static void insert_option(struct Slot *table, const struct Option *option) {
+    const size_t len = strlen(option->key);
 
-    // looks for the keyword
-    ptr = strstr(source, field);
-    if(ptr == NULL)
-        return 1;
+    uint32_t slot = hash_key(option->key, len) & (OPTION_SLOTS-1);
+    while(table[slot].option)
+        slot = (slot+1) & (OPTION_SLOTS-1);
 
-    // looks for the opening "
-    ptr = strchr(ptr, '"');
-    if(ptr == NULL)
-        return 1;
+    table[slot] = (struct Slot){option, len, false};
+}
 
-    // checks whether the string continues after
-    ++ptr;
-    if(*ptr == 0)
-        return 1;
+static struct Slot *find_option(struct Slot *table, const char *key, const size_t len) {
+    uint32_t slot = hash_key(key, len) & (OPTION_SLOTS-1);
 
-    // looks for the closing "
-    end = strchr(ptr, '"');
-    if(end == NULL)
-        return 1;
+    while(table[slot].option) {
+        if(table[slot].key_len == len && memcmp(table[slot].option->key, key, len) == 0)
+            return table + slot;
 
-    // copies the option
-    *end = 0;
-    
-    size_t len = strlen(ptr);
-    if(len+1 > maxlen) {
-        memcpy(dest, ptr, maxlen);
-        dest[maxlen-1] = 0;
+        slot = (slot+1) & (OPTION_SLOTS-1);
     }
-    else
-        memcpy(dest, ptr, len+1);
-
 
-    *end = '"';
-
-    return 0;
+    return NULL;
 }
 
-// a return code of 0 means that the option was parsed successfully
-int parse_config_int(const char *source, const char *field, int *dest, const unsigned max) {
-    char *ptr, *end;
-
-    // looks for the keyword
-    ptr = strstr(source, field);
-    if(ptr == NULL)
-        return 1;
+// save value to whatever option it belongs to
+static void set_option(const struct Option *option, const char *value, const size_t len) {
+    switch(option->type) {
+        case OPTION_STR: {
+            size_t copied = len < option->arg ? len : option->arg-1;
 
-    // looks for the opening "
-    ptr = strchr(ptr, '"');
-    if(ptr == NULL)
-        return 1;
-        
-    // checks whether the string continues after
-    ++ptr;
-    if(*ptr == 0)
-        return 1;
+            memcpy(option->dest, value, copied);
+            ((char *)option->dest)[copied] = 0;
 
-    // looks for the closing "
-    end = strchr(ptr, '"');
-    if(end == NULL)
-        return 1;
+            break;
+        }
+        case OPTION_INT: {
+            char num[16];
+            size_t copied = len < sizeof(num) ? len : sizeof(num)-1;
 
-    // copies the option
-    *end = 0;
-    int num = atoi(ptr);
-    *end = '"';
+            memcpy(num, value, copied);
+            num[copied] = 0;
 
-    if((unsigned)num > max)
-        return 1;
+            int parsed = atoi(num);
+            if((unsigned)parsed <= option->arg)
+                *(int *)option->dest = parsed;
 
-    *dest =  num;
+            break;
+        }
+        case OPTION_BOOL:
+            if(len == 5 && memcmp(value, "false", 5) == 0)
+                config.options &= ~((uint64_t)1 << option->arg);
+            else
+                config.options |= ((uint64_t)1 << option->arg);
 
-    return 0;
+            break;
+    }
 }
 
-// a return code of 0 means that the option was parsed successfully
-int parse_config_bool(const char *source, const char *field, bool *dest) {
-    char *ptr, *end;
-
-    // looks for the keyword
-    ptr = strstr(source, field);
-    if(ptr == NULL)
-        return 1;
-
-    // looks for the opening "
-    ptr = strchr(ptr, '"');
-    if(ptr == NULL)
-        return 1;
-        
-    // checks whether the string continues after
-    ++ptr;
-    if(*ptr == 0)
-        return 1;
+// write the escape sequence at src (starting with '\') to dest, returns how many bytes were read
+static size_t unescape_seq(const char *src, char *dest) {
+    switch(src[1]) {
+        case 0:     // a '\' at the very end is dropped
+            *dest = 0;
+            return 1;
+        case 'e':
+            *dest = '\033';
+            return 2;
+        case '0':
+            if(src[2] == '3' && src[3] == '3') {
+                *dest = '\033';
+                return 4;
+            }
+            *dest = '0';
+            return 2;
+        case 'n':
+            *dest = '\n';
+            return 2;
+        default:    // takes care of "\\" and any other sort of "\X"
+            *dest = src[1];
+            return 2;
+    }
+}
 
-    // looks for the closing "
-    end = strchr(ptr, '"');
-    if(end == NULL)
-        return 1;
+// remove comments (from ';' or '#' to the end of the line) and unescape str, in a single pass
+static void preprocess_config(char *str) {
+    const char *src = str;
+    char *dest = str;
+    bool quoted = false;
 
-    // copies the option
-    *end = 0;
-    *dest = strcmp(ptr, "false");
-    *end = '"';
+    while(*src) {
+        if(*src == '\\') {
+            src += unescape_seq(src, dest);
 
-    return 0;
-}
+            // an escaped " still counts, it is a " like any other once unescaped
+            if(*dest == '"')
+                quoted = !quoted;
+            if(*dest)
+                ++dest;
 
-// remove comments, aka from start to the end of the line
-void uncomment(char *str, const char start) {
-    char *ptr = str, *ptr2;
-    while((ptr = strchr(ptr, start))) {
-        // when it is between two " (aka the number of " before it is odd)
-        int counter = 0;
-        ptr2 = str;
-        while((ptr2 = strchr(ptr2, '"')) && ptr2 < ptr) {
-            ++ptr2;
-            ++counter;
-        }
-        if(counter&1) {
-            ++ptr;
             continue;
         }
 
-        ptr2 = strchr(ptr, '\n');
-        
-        if(ptr2 == NULL) {
-            *ptr = 0;
-            break;
+        if(*src == '"')
+            quoted = !quoted;
+        else if(quoted == false && (*src == '#' || *src == ';')) {
+            // skip to the end of the line, but keep the newline
+            src += strcspn(src, "\n");
+            continue;
         }
 
-        memmove(ptr, ptr2+1, strlen(ptr2));
+        *dest++ = *src++;
     }
+
+    *dest = 0;
 }
 
 // parse the provided config file
@@ -351,67 +309,13 @@ void parse_config(const char *file, struct Module *modules, void **ascii_ptr, bo
     conf[fread(conf, 1, len, fp)] = 0;
     fclose(fp);
 
-    // used later
-    char *ptr, *ptr2;
-
-    // remove comments
-    uncomment(conf, '#');
-    uncomment(conf, ';');
-
-    // handle escape sequences
-    unescape(conf);
+    // remove comments and handle escape sequences
+    preprocess_config(conf);
 
-    // GENERAL OPTIONS
-
-    // ascii art
+    // these are only applied once the whole file has been read, see below
     char path[96] = "";
-    parse_config_str(conf, "ascii_art", path, sizeof(path));
-    if(path[0])
-        *ascii_ptr = file_to_logo(path);
-    
-    // logo
     char logo[32] = "";
-    parse_config_str(conf, "logo", logo, sizeof(logo));
-    if(logo[0]) {
-        for(size_t i = 0; i < sizeof(logos)/sizeof(logos[0]); ++i)
-            if(strcmp(logos[i][0], logo) == 0) {
-                config.logo = logos[i];
-                strcpy(default_logo, logos[i][0]);
-                strcpy(config.color, logos[i][1]);
-            }
-    }
-
-    // color
     char color[16] = "";
-    parse_config_str(conf, "default_color", color, sizeof(color));
-    if(color[0]) {
-        const char *colors[][2] = {
-            {"black", "\033[30m"},
-            {"red", "\033[31m"},
-            {"green", "\033[32m"},
-            {"yellow", "\033[33m"},
-            {"blue", "\033[34m"},
-            {"purple", "\033[35m"},
-            {"cyan", "\033[36m"},
-            {"gray", "\033[90m"},
-            {"white", "\033[37m"},
-        };
-
-        for(int i = 0; i < 9; ++i)
-            if(strcmp(color, *colors[i]) == 0) {
-                strcpy(config.color, colors[i][1]);
-                strcpy(default_color, colors[i][1]);
-            }
-    }
-
-    // dash
-    parse_config_str(conf, "dash", config.dash, sizeof(config.dash));
-
-    // spacing
-    parse_config_int(conf, "spacing", &config.spacing, 64);
-
-    // separator
-    parse_config_str(conf, "separator_character", config.separator, sizeof(config.separator));
 
     // BOOLEAN OPTIONS (check utils.h)
 
@@ -442,28 +346,20 @@ void parse_config(const char *file, struct Module *modules, void **ascii_ptr, bo
         "pwd_path",
         "kernel_type",
         "col_background",
-        "bat_status"
+        "bat_status",
+        "parallel",
+        "cache",
+        "pkg_apk",
+        "pkg_xbps",
+        "pkg_portage",
+        "pkg_nix",
+        "cpu_max_freq",
+        "isa_compact",
+        "mem_swap",
+        "mem_hugepages",
+        "mem_avail_perc"
     };
 
-    bool buffer;
-    for(size_t i = 0; i < sizeof(booleanOptions)/sizeof(booleanOptions[0]); ++i) {
-        if(parse_config_bool(conf, booleanOptions[i], &buffer) == 0) {
-            if(buffer)
-                config.options |= ((uint64_t)1 << i);
-            else
-                config.options &= ~((uint64_t)1 << i);
-        }
-    }
-    *default_bold = bold;
-
-    // OTHER MODULE-RELATED OPTIONS
-
-    parse_config_int(conf, "gpu_index", &config.gpu_index, 3);
-
-    parse_config_str(conf, "date_format", config.date_format, sizeof(config.date_format));
-
-    parse_config_str(conf, "col_block_str", config.col_block_str, sizeof(config.col_block_str));
-
     // LABELS
 
     struct Prefix {
@@ -492,6 +388,7 @@ void parse_config(const char *file, struct Module *modules, void **ascii_ptr, bo
         {config.host_prefix, "host_prefix"},
         {config.bios_prefix, "bios_prefix"},
         {config.cpu_prefix, "cpu_prefix"},
+        {config.isa_prefix, "isa_prefix"},
         {config.gpu_prefix, "gpu_prefix"},
         {config.mem_prefix, "mem_prefix"},
         {config.pub_prefix, "pub_prefix"},
@@ -503,103 +400,212 @@ void parse_config(const char *file, struct Module *modules, void **ascii_ptr, bo
         {config.light_colors_prefix, "colors_light_prefix"},
     };
 
-    for(size_t i = 0; i < sizeof(prefixes)/sizeof(prefixes[0]); ++i)
-        parse_config_str(conf, prefixes[i].config_name, prefixes[i].option, 64);
+    // GENERAL AND OTHER MODULE-RELATED OPTIONS
+
+    struct Option general[] = {
+    //  {"key", type, dest, max size or value}
+        {"ascii_art", OPTION_STR, path, sizeof(path)},
+        {"logo", OPTION_STR, logo, sizeof(logo)},
+        {"default_color", OPTION_STR, color, sizeof(color)},
+        {"dash", OPTION_STR, config.dash, sizeof(config.dash)},
+        {"spacing", OPTION_INT, &config.spacing, 64},
+        {"separator_character", OPTION_STR, config.separator, sizeof(config.separator)},
+        {"gpu_index", OPTION_INT, &config.gpu_index, 64},
+        {"pkg_timeout", OPTION_INT, &config.pkg_timeout, 60000},
+        {"pub_timeout", OPTION_INT, &config.pub_timeout, 60000},
+        {"pub_ttl", OPTION_INT, &config.pub_ttl, 604800},
+        {"date_format", OPTION_STR, config.date_format, sizeof(config.date_format)},
+        {"col_block_str", OPTION_STR, config.col_block_str, sizeof(config.col_block_str)},
+    };
 
-    // MODULES
-    
-    ptr = strstr(conf, "modules");
-    if(ptr == NULL) {
-        free(conf);
-        return;
-    }
+    const size_t general_num = sizeof(general)/sizeof(general[0]);
+    const size_t bool_num = sizeof(booleanOptions)/sizeof(booleanOptions[0]);
+    const size_t prefix_num = sizeof(prefixes)/sizeof(prefixes[0]);
+
+    // every known key, looked up through a hash table
+    struct Option options[general_num + bool_num + prefix_num];
+    struct Slot table[OPTION_SLOTS] = {{NULL, 0, false}};
+    size_t option_num = 0;
+
+    for(size_t i = 0; i < general_num; ++i)
+        options[option_num++] = general[i];
+    for(size_t i = 0; i < bool_num; ++i)
+        options[option_num++] = (struct Option){booleanOptions[i], OPTION_BOOL, NULL, i};
+    for(size_t i = 0; i < prefix_num; ++i)
+        options[option_num++] = (struct Option){prefixes[i].config_name, OPTION_STR, prefixes[i].option, 64};
+
+    for(size_t i = 0; i < option_num; ++i)
+        insert_option(table, options + i);
+
+    /* a single pass over the file, reading one of these at a time:
+     *   key = "value"
+     *   modules = { "module1", "module2", ... }
+     *   pub_endpoints = { "endpoint1", "endpoint2", ... }
+     * anything else is skipped
+     */
+    bool modules_seen = false, endpoints_seen = false;
+    char *ptr = conf;
+    while(*ptr) {
+        // looks for the next key
+        if(!(isalnum((unsigned char)*ptr) || *ptr == '_')) {
+            ++ptr;
+            continue;
+        }
 
-    ptr2 = strchr(ptr, '{');
-    if(ptr2 == NULL) {
-        free(conf);
-        return;
-    }
+        const char *key = ptr;
+        while(isalnum((unsigned char)*ptr) || *ptr == '_')
+            ++ptr;
+        const size_t key_len = (size_t)(ptr - key);
 
-    char *end = strchr(ptr2, '}');
-    if(end == NULL) {
-        free(conf);
-        return;
-    }
-    *end = 0;
+        while(isspace((unsigned char)*ptr))
+            ++ptr;
+        if(*ptr == '=')
+            ++ptr;
+        while(isspace((unsigned char)*ptr))
+            ++ptr;
+
+        if(*ptr == '"') {   // key = "value"
+            const char *value = ++ptr;
 
-    while((ptr = strchr(ptr2, '"'))) {
-        ++ptr;
+            char *end = strchr(value, '"');
+            if(end == NULL)
+                break;
+            ptr = end+1;
 
-        ptr2 = strchr(ptr, '"');
-        if(ptr2 == NULL) {
-            free(conf);
-            return;
+            struct Slot *slot = find_option(table, key, key_len);
+            if(slot && slot->seen == false) {
+                set_option(slot->option, value, (size_t)(end - value));
+                slot->seen = true;
+            }
         }
-        *ptr2 = 0;
+        else if(*ptr == '{') {  // key = { "value1", "value2", ... }
+            // a list that is never closed is ignored, along with the rest of the file
+            char *close = strchr(ptr, '}');
+            if(close == NULL)
+                break;
+
+            const bool is_modules = modules_seen == false && key_len == 7 && memcmp(key, "modules", 7) == 0;
+            if(is_modules)
+                modules_seen = true;
+
+            // the list replaces the default endpoints
+            const bool is_endpoints = endpoints_seen == false && key_len == 13 && memcmp(key, "pub_endpoints", 13) == 0;
+            size_t endpoint_count = 0;
+            if(is_endpoints) {
+                endpoints_seen = true;
+                memset(config.pub_endpoints, 0, sizeof(config.pub_endpoints));
+            }
+
+            ++ptr;
+            while(ptr < close) {
+                if(*ptr != '"') {
+                    ++ptr;
+                    continue;
+                }
+
+                char *value = ++ptr;
+                char *end = strchr(value, '"');
+                if(end == NULL)
+                    break;
+                ptr = end+1;
+
+                // a '}' between quotes is part of a value
+                if(end > close && (close = strchr(ptr, '}')) == NULL)
+                    break;
+
+                if(is_modules) {
+                    *end = 0;
+                    add_module(modules, value);
+                }
+                else if(is_endpoints && endpoint_count < PUB_ENDPOINTS
+                        && (size_t)(end - value) < sizeof(config.pub_endpoints[0])) {
+                    memcpy(config.pub_endpoints[endpoint_count], value, (size_t)(end - value));
+                    ++endpoint_count;
+                }
+            }
+
+            if(close == NULL)
+                break;
+            ptr = close+1;
+        }
+    }
+
+    // applied in this order, as they override each other
 
-        add_module(modules, ptr);
+    // ascii art
+    if(path[0])
+        *ascii_ptr = file_to_logo(path);
+    
+    // logo
+    if(logo[0]) {
+        for(size_t i = 0; i < sizeof(logos)/sizeof(logos[0]); ++i)
+            if(strcmp(logos[i][0], logo) == 0) {
+                config.logo = logos[i];
+                strcpy(default_logo, logos[i][0]);
+                strcpy(config.color, logos[i][1]);
+            }
+    }
+
+    // color
+    if(color[0]) {
+        const char *colors[][2] = {
+            {"black", "\033[30m"},
+            {"red", "\033[31m"},
+            {"green", "\033[32m"},
+            {"yellow", "\033[33m"},
+            {"blue", "\033[34m"},
+            {"purple", "\033[35m"},
+            {"cyan", "\033[36m"},
+            {"gray", "\033[90m"},
+            {"white", "\033[37m"},
+        };
 
-     // *ptr2 = '"';
-        ++ptr2;
+        for(int i = 0; i < 9; ++i)
+            if(strcmp(color, *colors[i]) == 0) {
+                strcpy(config.color, colors[i][1]);
+                strcpy(default_color, colors[i][1]);
+            }
     }
 
- // *end = '}';
+    *default_bold = bold;
 
     free(conf);
 }
 
 // check every '\' in str and unescape "\\" "\n" "\e" "\033"
 void unescape(char *str) {
-    while((str = strchr(str, '\\'))) {
-        switch(str[1]) {
-            case 'e':
-                memmove(str, str+1, strlen(str));
-                *str = '\033';
-                break;
-            case '0':
-                if(str[2] == '3' && str[3] == '3') {
-                    memmove(str, str+3, strlen(str+2));
-                    *str = '\033';
-                }
-                break;
-            case 'n':
-                memmove(str, str+1, strlen(str));
-                *str = '\n';
-                break;
-            default:    // takes care of "\\" and any other sort of "\X"
-                memmove(str, str+1, strlen(str));
-                ++str;
-                break;
+    const char *src = str;
+    char *dest = str;
+
+    while(*src) {
+        if(*src == '\\') {
+            src += unescape_seq(src, dest);
+            if(*dest)
+                ++dest;
         }
+        else
+            *dest++ = *src++;
     }
+
+    *dest = 0;
 }
 
+// run a command and save its output (without the last newline) to buf
+// a return code of 0 means that the command ran and exited with 0
 int exec_cmd(char *buf, size_t len, char *const *argv) {
-    int stderr_pipes[2];
-    int stdout_pipes[2];
+    struct Proc proc = {
+        .argv = argv,
+        .buf = buf,
+        .len = len,
+        .timeout = PROC_TIMEOUT,
+    };
 
-    if(pipe(stdout_pipes) != 0 || pipe(stderr_pipes) != 0)
+    if(proc_start(&proc))
         return 1;
 
-    if(fork() == 0) {
-        close(stdout_pipes[0]);
-        close(stderr_pipes[0]);
-        dup2(stdout_pipes[1], STDOUT_FILENO);
-        dup2(stderr_pipes[1], STDERR_FILENO);
-
-        execvp(argv[0], argv);
-    }
-
-    wait(0);
-
-    close(stderr_pipes[0]);
-    close(stderr_pipes[1]);
-
-    close(stdout_pipes[1]);
-    buf[read(stdout_pipes[0], buf, len) - 1] = 0;
-    close(stdout_pipes[0]);
+    proc_collect(&proc, 1);
 
-    return 0;
+    return proc.status != 0;
 }
 
 // get the printed length of a string (not how big it is in memory)
@@ -611,7 +617,7 @@ __attribute__((pure)) size_t strlen_real(const char *str) {
 
     bool escaping = false;
 
-    // determine how long the printed string is (same logic as in print_line, utils.c)
+    // determine how long the printed string is (same logic as in append_text, render.c)
     while(*str) {
         if(*str == '\n')
             break;
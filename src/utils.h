@@ -8,6 +8,14 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+// how many endpoints public_ip may ask at once
+#define PUB_ENDPOINTS 4
+
+// asked when none are configured
+#define DEFAULT_PUB_ENDPOINTS {"whatismyip.akamai.com", "icanhazip.com", "api.ipify.org"}
 
 struct Config {
     /* Starting from the least significant byte, see the #define statements later
@@ -35,8 +43,21 @@ struct Config {
     * 21. loc_localhost
     * 22. loc_docker
     * 23. pwd_path
-    * 24. col_background
-    * 25. [...]
+    * 24. kernel_type
+    * 25. col_background
+    * 26. bat_status
+    * 27. parallel
+    * 28. cache
+    * 29. pkg_apk
+    * 30. pkg_xbps
+    * 31. pkg_portage
+    * 32. pkg_nix
+    * 33. cpu_max_freq
+    * 34. isa_compact
+    * 35. mem_swap
+    * 36. mem_hugepages
+    * 37. mem_avail_perc
+    * 38. [...]
     */
     uint64_t options;
 
@@ -47,8 +68,12 @@ struct Config {
     int spacing;
 
     int gpu_index;
+    int pkg_timeout;
+    int pub_timeout;
+    int pub_ttl;
     char date_format[32];
     char col_block_str[24];
+    char pub_endpoints[PUB_ENDPOINTS][64];  // "host[:port][/path]", empty if unused
 
     char separator_prefix[64];
     char spacing_prefix[64];
@@ -69,6 +94,7 @@ struct Config {
     char host_prefix[64];
     char bios_prefix[64];
     char cpu_prefix[64];
+    char isa_prefix[64];
     char gpu_prefix[64];
     char mem_prefix[64];
     char pub_prefix[64];
@@ -108,12 +134,30 @@ extern struct Config config;
 #define kernel_type     config.options & 0x1000000
 #define col_background  config.options & 0x2000000
 #define bat_status      config.options & 0x4000000
+#define parallel        config.options & 0x8000000
+#define cache           config.options & 0x10000000
+#define pkg_apk         config.options & 0x20000000
+#define pkg_xbps        config.options & 0x40000000
+#define pkg_portage     config.options & 0x80000000
+#define pkg_nix         config.options & 0x100000000
+#define cpu_max_freq    config.options & 0x200000000
+#define isa_compact     config.options & 0x400000000
+#define mem_swap        config.options & 0x800000000
+#define mem_hugepages   config.options & 0x1000000000
+#define mem_avail_perc  config.options & 0x2000000000
+
+struct Context;
 
 // element of a module linked list
 struct Module {
     char *id;               // module identifier
     char *label;            // module label
-    int (*func)(char *);    // function to run
+    int (*func)(char *, struct Context *);  // function to run
+    int (*fingerprint)(char *); // cache fingerprint, NULL if it's never cached
+    char data[256];         // output of func
+    int ret;                // return value of func
+    char key[320];          // fingerprint (and options) data was made with, empty if unknown
+    time_t made;            // when data was made
     struct Module *next;    // next module
 };
 
@@ -123,10 +167,6 @@ void add_module(struct Module *array, char *id);
 
 void destroy_array(struct Module *array);
 
-void get_logo_line(char *dest, unsigned *line);
-
-void print_line(char *line, const size_t maxlen);
-
 void parse_config(const char *file, struct Module *modules, void **ascii_ptr, bool *default_bold, char *default_color, char *default_logo);
 
 void unescape(char *str);